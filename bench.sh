@@ -0,0 +1,4 @@
+#!/bin/bash 
+# build, then benchmark the bundled test scenes, results go to bench.json
+# usage: ./bench.sh [--quick] [--runs N] [--size W H] [--json file]
+./compile.sh && ./raytracing --bench "$@"
@@ -1,2 +1,2 @@
 #!/bin/bash 
-g++ src/math/*.h src/*.h src/*.cpp -lstdc++ -o2 -std=c++11 -o raytracing
+g++ src/math/*.h src/*.h src/*.cpp -lstdc++ -pthread -O2 -std=c++17 -o raytracing "$@"
@@ -0,0 +1,150 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#include "arena.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+
+static std::atomic<size_t> num_heap_allocations(0);
+
+Arena::Arena(size_t block_size) : block_size(block_size), current(0)
+{}
+
+Arena::~Arena()
+{
+	reset();
+	for(size_t i = 0; i < blocks.size(); ++i)
+		free(blocks[i].data);
+}
+
+void *Arena::allocate(size_t size, size_t align)
+{
+	// the current block, then the ones kept by a rewind, then a new one
+	for(; current < blocks.size(); ++current)
+	{
+		Block &b = blocks[current];
+		size_t start = (b.used + align - 1) & ~(align - 1);
+		if(start + size <= b.size)
+		{
+			b.used = start + size;
+			return b.data + start;
+		}
+		if(current + 1 < blocks.size())
+			blocks[current + 1].used = 0;
+	}
+
+	// blocks come from malloc, which aligns them for any type
+	Block b;
+	b.size = std::max(block_size, size);
+	b.data = static_cast<char*>(malloc(b.size));
+	num_heap_allocations.fetch_add(1, std::memory_order_relaxed);
+	if(!b.data)
+		throw std::bad_alloc();
+	b.used = size;
+	blocks.push_back(b);
+	current = blocks.size() - 1;
+	return b.data;
+}
+
+void Arena::add_destructor(void *obj, void (*destroy)(void *))
+{
+	Destructor d = { obj, destroy };
+	destructors.push_back(d);
+}
+
+void Arena::rewind(const Mark &m)
+{
+	while(destructors.size() > m.destructors)
+	{
+		destructors.back().destroy(destructors.back().object);
+		destructors.pop_back();
+	}
+	if(blocks.empty())
+		return;
+	current = m.block;
+	blocks[current].used = m.used;
+}
+
+void Arena::take(Arena &other)
+{
+	// the blocks of other are already filled, they go before the one
+	// being filled here so it keeps its free space
+	Block last = blocks.empty() ? Block() : blocks.back();
+	if(!blocks.empty())
+		blocks.pop_back();
+	blocks.insert(blocks.end(), other.blocks.begin(), other.blocks.end());
+	if(last.data)
+		blocks.push_back(last);
+	current = blocks.empty() ? 0 : blocks.size() - 1;
+	destructors.insert(destructors.end(), other.destructors.begin(), other.destructors.end());
+
+	other.blocks.clear();
+	other.destructors.clear();
+	other.current = 0;
+}
+
+size_t Arena::bytes_reserved() const
+{
+	size_t bytes = 0;
+	for(size_t i = 0; i < blocks.size(); ++i)
+		bytes += blocks[i].size;
+	return bytes;
+}
+
+//////////////////////////////////////////////////////////
+/// Heap allocation counter
+//////////////////////////////////////////////////////////
+
+size_t heap_allocations()
+{
+	return num_heap_allocations.load(std::memory_order_relaxed);
+}
+
+// every allocation of the program goes through these, so the renderer can
+// check its loops do not touch the heap
+void *operator new(size_t size)
+{
+	num_heap_allocations.fetch_add(1, std::memory_order_relaxed);
+	if(void *p = malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+	free(p);
+}
@@ -0,0 +1,104 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// size of the memory blocks an arena reserves at a time
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+// Bump allocator. Memory is taken from large blocks and given back all at
+// once, objects made with create are destroyed with the arena, in reverse
+// order. Not thread safe, each thread fills its own arena.
+class Arena
+{
+public:
+	// position to rewind the arena to
+	struct Mark
+	{
+		size_t block;
+		size_t used;
+		size_t destructors;
+	};
+
+	explicit Arena(size_t block_size = ARENA_BLOCK_SIZE);
+	~Arena();
+
+	void *allocate(size_t size, size_t align = alignof(std::max_align_t));
+
+	template<class T, class... Args>
+	T *create(Args&&... args)
+	{
+		T *obj = new(allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+		if(!std::is_trivially_destructible<T>::value)
+			add_destructor(obj, [](void *p) { static_cast<T*>(p)->~T(); });
+		return obj;
+	}
+
+	// uninitialized storage for count values, e.g. temporary per ray data
+	template<class T>
+	T *allocate_array(size_t count)
+	{
+		static_assert(std::is_trivially_destructible<T>::value, "arena arrays are not destroyed");
+		return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+	}
+
+	inline Mark mark() const { Mark m = { current, blocks.empty() ? 0 : blocks[current].used, destructors.size() }; return m; }
+	// destroy the objects made after the mark and reuse their memory
+	void rewind(const Mark &m);
+	// destroy every object, the blocks are kept for reuse
+	inline void reset() { rewind(Mark()); }
+	// move the objects and blocks of other to this arena, other is left empty
+	void take(Arena &other);
+
+	size_t bytes_reserved() const;
+
+private:
+	struct Block
+	{
+		char *data;
+		size_t size;
+		size_t used;
+	};
+	struct Destructor
+	{
+		void *object;
+		void (*destroy)(void *);
+	};
+
+	size_t block_size;
+	std::vector<Block> blocks;
+	size_t current;		// block being filled
+	std::vector<Destructor> destructors;
+
+	void add_destructor(void *obj, void (*destroy)(void *));
+
+	// not copyable, it owns its objects
+	Arena(const Arena &);
+	Arena &operator=(const Arena &);
+};
+
+// number of operator new calls and arena blocks since the program
+// started, in every thread
+size_t heap_allocations();
+
+#endif
@@ -0,0 +1,511 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#include "bench.h"
+#include "scene.h"
+#include "raytracer.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#include <direct.h>
+#pragma comment(lib, "psapi.lib")
+#define chdir _chdir
+#define NULL_OUTPUT "NUL"
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#define NULL_OUTPUT "/dev/null"
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <cstring>
+#endif
+
+// scenes rendered by the benchmark, in the scenes directory
+static const char *bench_scenes[] = { "test1", "test2", "test3", "test4", "test5", "test6", "test7", "test_shapes" };
+
+struct BenchOptions
+{
+	bool quick;
+	int runs;
+	size_t width, height;
+	size_t parse_objects;	// objects of the generated scene
+	size_t parse_mb;		// size asked for the generated scene, 0 for the default
+	std::string scenes;
+	std::string json;
+	std::vector<PixelOrder> orders;
+	bool wavefront;
+	TextureFilter texture_filter;
+};
+
+struct SceneResult
+{
+	std::string name;
+	PixelOrder order;
+	int samples;
+	double load_seconds;
+	std::vector<double> seconds;	// one per run
+	RayCounts rays;
+	RenderStats stats;
+	WavefrontStats stages;	// of the last run
+	long long cache_misses;	// of the last run, -1 where they cannot be counted
+	size_t peak_rss;
+};
+
+struct ParseResult
+{
+	size_t objects;
+	size_t bytes;
+	double text_seconds;
+	double binary_seconds;
+};
+
+static double now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// the peak is reset before each scene where the system allows it,
+// otherwise it is the peak of the whole process so far
+static void reset_peak_rss()
+{
+#ifdef __linux__
+	std::ofstream clear("/proc/self/clear_refs");
+	if(clear)
+		clear << "5";
+#endif
+}
+
+static size_t peak_rss()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS pmc;
+	if(GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+		return pmc.PeakWorkingSetSize;
+	return 0;
+#else
+#ifdef __linux__
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while(std::getline(status, line))
+		if(line.compare(0, 6, "VmHWM:") == 0)
+			return strtoull(line.c_str() + 6, NULL, 10) * 1024;
+#endif
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return usage.ru_maxrss;
+#else
+	return usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+// hardware cache misses of the process, counted where the system lets us
+class CacheMissCounter
+{
+public:
+	CacheMissCounter() : fd(-1)
+	{
+#ifdef __linux__
+		struct perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.size = sizeof(attr);
+		attr.config = PERF_COUNT_HW_CACHE_MISSES;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+	}
+	~CacheMissCounter()
+	{
+#ifdef __linux__
+		if(fd >= 0)
+			close(fd);
+#endif
+	}
+
+	void start()
+	{
+#ifdef __linux__
+		if(fd >= 0)
+		{
+			ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+
+	long long stop()
+	{
+		long long count = -1;
+#ifdef __linux__
+		if(fd >= 0)
+		{
+			ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+			if(read(fd, &count, sizeof(count)) != sizeof(count))
+				count = -1;
+		}
+#endif
+		return count;
+	}
+
+private:
+	int fd;
+};
+
+static void mean_stddev(const std::vector<double> &v, double &mean, double &stddev)
+{
+	mean = 0;
+	for(size_t i = 0; i < v.size(); ++i)
+		mean += v[i];
+	mean /= v.size();
+	double var = 0;
+	for(size_t i = 0; i < v.size(); ++i)
+		var += (v[i] - mean) * (v[i] - mean);
+	stddev = v.size() > 1 ? sqrt(var / (v.size() - 1)) : 0;
+}
+
+static SceneResult bench_scene(const BenchOptions &opt, const std::string &name, PixelOrder order)
+{
+	static char null_output[] = NULL_OUTPUT;
+	SceneResult res;
+	res.name = name;
+	res.order = order;
+	reset_peak_rss();
+
+	Scene scene;
+	scene.screen.width_px = opt.width;
+	scene.screen.height_px = opt.height;
+	scene.output = null_output;
+	std::string file = name + ".in";
+	double start = now();
+	scene.load(file.c_str());
+	res.load_seconds = now() - start;
+	res.samples = scene.screen.samples;
+
+	CacheMissCounter misses;
+	for(int i = 0; i < opt.runs; ++i)
+	{
+		Raytracer rt(4);
+		rt.verbose = false;
+		rt.order = order;
+		rt.wavefront = opt.wavefront;
+		rt.texture_filter = opt.texture_filter;
+		misses.start();
+		start = now();
+		rt.compute(scene);
+		res.seconds.push_back(now() - start);
+		res.cache_misses = misses.stop();
+		// every run traces the same rays
+		res.rays = rt.ray_counts();
+		res.stats = rt.render_stats();
+		res.stages = rt.wavefront_stats();
+	}
+	res.peak_rss = peak_rss();
+	return res;
+}
+
+// average length of a sphere line of the generated scene
+#define PARSE_SPHERE_BYTES 64
+
+// text scene of random spheres, the shape parsed the most in large scenes
+static void write_parse_scene(const std::string &file, size_t count)
+{
+	std::ofstream out(file.c_str());
+	out << "0 0 30\n0 0 0\n0 1 0\n60 1 0.0 60 1 1\n"
+		<< "2\n0 0 0  0.2 0.2 0.2  1 0 0\n20 40 60  1 1 1  1 0 0 noarea 1 0\n"
+		<< "1\nsolid 1 0.3 0.2\n1\n0.2 0.7 0.3 50 0 0 0\n"
+		<< count << "\n";
+
+	// fixed linear congruential sequence, so every build reads the same file
+	unsigned int seed = 12345;
+	auto next = [&]() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / 16777216.0f; };
+	char line[160];
+	for(size_t i = 0; i < count; ++i)
+	{
+		float x = next() * 200 - 100, y = next() * 200 - 100, z = next() * 200 - 100;
+		snprintf(line, sizeof(line), "0 0 sphere %f %f %f %f 1 1 1 0 0 0\n", x, y, z, 0.1f + next());
+		out << line;
+	}
+}
+
+// textured spheres on a textured floor, both mapped from a large noise
+// image, so the texel fetches weigh on the render
+static void write_texture_scene(const std::string &file, const std::string &texture, size_t size)
+{
+	std::ofstream out(file.c_str());
+	out << "0 6 30\n0 0 -40\n0 1 0\n60 1 0.0 60 1 1\n"
+		<< "2\n0 0 0  0.3 0.3 0.3  1 0 0\n20 40 60  1 1 1  1 0 0 noarea 1 0\n"
+		<< "2\ntexmap " << texture << "  0.01 0 0 0  0 0 0.01 0\n"
+		<< "texmap " << texture << "  0.01 0.004 0 0  0 0.004 0.01 0\n"
+		<< "1\n0.3 0.7 0.2 20 0 0 0\n";
+	const int rows = 5, cols = 8;
+	out << 1 + rows * cols << "\n0 0 sphere 0 -10000 0 10000 1 1 1 0 0 0\n";
+	for(int i = 0; i < rows; ++i)
+		for(int j = 0; j < cols; ++j)
+			out << "1 0 sphere " << (j - cols / 2) * 9 + 4.5f << " 3 " << -i * 15 << " 3 1 1 1 0 0 0\n";
+	out.close();
+
+	// the texels never take the values of blanks, the image loader reads
+	// them as formatted characters
+	std::ofstream image(texture.c_str(), std::ios::binary);
+	image << "P6\n" << size << " " << size << "\n255\n";
+	unsigned int seed = 54321;
+	std::vector<char> row(size * 3);
+	for(size_t h = 0; h < size; ++h)
+	{
+		for(size_t k = 0; k < row.size(); ++k)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			row[k] = (char)(40 + (seed >> 24) % 216);
+		}
+		image.write(&row[0], row.size());
+	}
+}
+
+static ParseResult bench_parse(const BenchOptions &opt)
+{
+	ParseResult res;
+	res.objects = opt.parse_objects;
+	const std::string text = "bench_parse.in", binary = "bench_parse.rtsc";
+	write_parse_scene(text, res.objects);
+	std::ifstream size(text.c_str(), std::ios::binary | std::ios::ate);
+	res.bytes = (size_t)size.tellg();
+	size.close();
+
+	// loading also builds the bvh, for both files
+	double start = now();
+	{
+		Scene scene;
+		scene.load(text.c_str());
+		res.text_seconds = now() - start;
+		scene.save_binary(binary.c_str());
+	}
+	start = now();
+	{
+		Scene scene;
+		scene.load(binary.c_str());
+		res.binary_seconds = now() - start;
+	}
+	remove(text.c_str());
+	remove(binary.c_str());
+	return res;
+}
+
+static void write_json(std::ostream &out, const BenchOptions &opt, const std::vector<SceneResult> &scenes, const ParseResult &parse)
+{
+	out << "{\n"
+		<< "  \"mode\": \"" << (opt.quick ? "quick" : "full") << "\",\n"
+		<< "  \"width\": " << opt.width << ",\n"
+		<< "  \"height\": " << opt.height << ",\n"
+		<< "  \"runs\": " << opt.runs << ",\n"
+		<< "  \"renderer\": \"" << (opt.wavefront ? "wavefront" : "recursive") << "\",\n"
+		<< "  \"texture_filter\": \"" << (opt.texture_filter == NearestFilter ? "nearest" : "trilinear") << "\",\n"
+		<< "  \"scenes\": [\n";
+	for(size_t i = 0; i < scenes.size(); ++i)
+	{
+		const SceneResult &r = scenes[i];
+		double mean, stddev;
+		mean_stddev(r.seconds, mean, stddev);
+		auto mrays = [&](size_t count) { return count / mean * 1e-6; };
+		out << "    {\n"
+			<< "      \"name\": \"" << r.name << "\",\n"
+			<< "      \"order\": \"" << PixelTraversal::name(r.order) << "\",\n"
+			<< "      \"samples\": " << r.samples << ",\n"
+			<< "      \"load_seconds\": " << r.load_seconds << ",\n"
+			<< "      \"seconds\": [";
+		for(size_t j = 0; j < r.seconds.size(); ++j)
+			out << (j ? ", " : "") << r.seconds[j];
+		out << "],\n"
+			<< "      \"mean_seconds\": " << mean << ",\n"
+			<< "      \"stddev_seconds\": " << stddev << ",\n"
+			<< "      \"rays\": { \"camera\": " << r.rays.camera << ", \"shadow\": " << r.rays.shadow 
+			<< ", \"reflection\": " << r.rays.reflection << ", \"refraction\": " << r.rays.refraction 
+			<< ", \"total\": " << r.rays.total() << " },\n"
+			<< "      \"mrays_per_second\": { \"camera\": " << mrays(r.rays.camera) << ", \"shadow\": " << mrays(r.rays.shadow) 
+			<< ", \"reflection\": " << mrays(r.rays.reflection) << ", \"refraction\": " << mrays(r.rays.refraction) 
+			<< ", \"total\": " << mrays(r.rays.total()) << " },\n";
+		if(opt.wavefront)
+		{
+			out << "      \"stages\": ";
+			r.stages.write_json(out, "      ");
+			out << ",\n";
+		}
+#ifdef RAYTRACER_STATS
+		out << "      \"stats\": ";
+		r.stats.write_json(out, "      ");
+		out << ",\n";
+#endif
+		out << "      \"cache_misses\": ";
+		if(r.cache_misses >= 0)
+			out << r.cache_misses;
+		else
+			out << "null";
+		out << ",\n"
+			<< "      \"peak_rss_bytes\": " << r.peak_rss << "\n"
+			<< "    }" << (i + 1 < scenes.size() ? "," : "") << "\n";
+	}
+	double mb = parse.bytes / (1024.0 * 1024.0);
+	out << "  ],\n"
+		<< "  \"parse\": {\n"
+		<< "    \"objects\": " << parse.objects << ",\n"
+		<< "    \"bytes\": " << parse.bytes << ",\n"
+		<< "    \"text_seconds\": " << parse.text_seconds << ",\n"
+		<< "    \"text_mb_per_second\": " << mb / parse.text_seconds << ",\n"
+		<< "    \"binary_seconds\": " << parse.binary_seconds << "\n"
+		<< "  }\n"
+		<< "}\n";
+}
+
+int run_bench(int argc, char **argv)
+{
+	BenchOptions opt;
+	opt.quick = false;
+	opt.runs = 0;
+	opt.width = 0;
+	opt.height = 0;
+	opt.scenes = "bin/testes";
+	opt.json = "bench.json";
+	opt.wavefront = false;
+	opt.texture_filter = TrilinearFilter;
+	opt.parse_mb = 0;
+	PixelOrder order;
+	for(int i = 0; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if(arg == "--quick")
+			opt.quick = true;
+		else if(arg == "--wavefront")
+			opt.wavefront = true;
+		else if(arg == "--texture-filter" && i + 1 < argc && MipMap::parse_filter(argv[i + 1], opt.texture_filter))
+			++i;
+		else if(arg == "--runs" && i + 1 < argc)
+			opt.runs = atoi(argv[++i]);
+		else if(arg == "--size" && i + 2 < argc)
+		{
+			opt.width = strtoul(argv[++i], NULL, 10);
+			opt.height = strtoul(argv[++i], NULL, 10);
+		}
+		else if(arg == "--scenes" && i + 1 < argc)
+			opt.scenes = argv[++i];
+		else if(arg == "--json" && i + 1 < argc)
+			opt.json = argv[++i];
+		else if(arg == "--parse-mb" && i + 1 < argc)
+			opt.parse_mb = strtoul(argv[++i], NULL, 10);
+		else if(arg == "--order" && i + 1 < argc && std::string(argv[i + 1]) == "all")
+		{
+			++i;
+			opt.orders.push_back(ScanlineOrder);
+			opt.orders.push_back(MortonOrder);
+			opt.orders.push_back(HilbertOrder);
+		}
+		else if(arg == "--order" && i + 1 < argc && PixelTraversal::parse(argv[i + 1], order))
+		{
+			++i;
+			opt.orders.push_back(order);
+		}
+		else
+		{
+			std::cerr << "bench options: [--quick] [--runs N] [--size W H] [--scenes dir] [--json file]" 
+				" [--order scanline|morton|hilbert|all] [--wavefront] [--texture-filter nearest|trilinear] [--parse-mb N]" << std::endl;
+			return 1;
+		}
+	}
+	if(opt.orders.empty())
+		opt.orders.push_back(ScanlineOrder);
+	// the quick mode takes a few seconds, the full one a few minutes
+	if(opt.runs <= 0)
+		opt.runs = opt.quick ? 3 : 5;
+	if(opt.width == 0 || opt.height == 0)
+	{
+		opt.width = opt.quick ? 160 : 640;
+		opt.height = opt.quick ? 120 : 480;
+	}
+	// about 12 MB and 60 MB by default. A 1 GB scene (--parse-mb 1024)
+	// holds 16 million spheres, several GB once loaded, so it is asked for
+	opt.parse_objects = opt.quick ? 200000 : 1000000;
+	if(opt.parse_mb > 0)
+		opt.parse_objects = opt.parse_mb * 1024 * 1024 / PARSE_SPHERE_BYTES;
+
+	// opened before moving to the scenes, which load their textures
+	// from their own directory
+	std::ofstream json(opt.json.c_str());
+	if(!json)
+	{
+		std::cerr << "Failed to open benchmark output (" << opt.json << ")." << std::endl;
+		return 1;
+	}
+	if(chdir(opt.scenes.c_str()) != 0)
+	{
+		std::cerr << "Failed to open the scenes directory (" << opt.scenes << ")." << std::endl;
+		return 1;
+	}
+
+	std::vector<SceneResult> scenes;
+	char line[200];
+	snprintf(line, sizeof(line), "%-12s %-8s %4s %10s %8s %10s %12s %10s", "scene", "order", "spp", "mean ms", "stddev", 
+		"Mrays/s", "misses/ray", "peak MB");
+	std::cout << line << std::endl;
+	auto run = [&](const std::string &name, PixelOrder order)
+	{
+		SceneResult r = bench_scene(opt, name, order);
+		double mean, stddev;
+		mean_stddev(r.seconds, mean, stddev);
+		char misses[32] = "n/a";
+		if(r.cache_misses >= 0)
+			snprintf(misses, sizeof(misses), "%.3f", (double)r.cache_misses / r.rays.total());
+		snprintf(line, sizeof(line), "%-12s %-8s %4d %10.1f %7.1f%% %10.2f %12s %10.1f", r.name.c_str(), 
+			PixelTraversal::name(r.order), r.samples, mean * 1000, 100 * stddev / mean, r.rays.total() / mean * 1e-6, 
+			misses, r.peak_rss / (1024.0 * 1024.0));
+		std::cout << line << std::endl;
+		scenes.push_back(r);
+	};
+	for(size_t i = 0; i < sizeof(bench_scenes) / sizeof(bench_scenes[0]); ++i)
+		for(size_t k = 0; k < opt.orders.size(); ++k)
+			run(bench_scenes[i], opt.orders[k]);
+
+	// generated texture heavy scene
+	write_texture_scene("gen_textures.in", "gen_textures.ppm", opt.quick ? 1024 : 2048);
+	for(size_t k = 0; k < opt.orders.size(); ++k)
+		run("gen_textures", opt.orders[k]);
+	remove("gen_textures.in");
+	remove("gen_textures.ppm");
+
+	ParseResult parse = bench_parse(opt);
+	snprintf(line, sizeof(line), "load of %zu spheres (%.1f MB): text %.2f s (%.1f MB/s), compiled %.2f s", 
+		parse.objects, parse.bytes / (1024.0 * 1024.0), parse.text_seconds, 
+		parse.bytes / (1024.0 * 1024.0) / parse.text_seconds, parse.binary_seconds);
+	std::cout << line << std::endl;
+
+	write_json(json, opt, scenes, parse);
+	return 0;
+}
@@ -0,0 +1,34 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#ifndef BENCH_H
+#define BENCH_H
+
+// Benchmark over the bundled test scenes: every scene is rendered several
+// times at a fixed resolution, as well as a generated scene with a large
+// texture, then a generated scene measures the load throughput. Results
+// are printed and written as JSON.
+// --wavefront renders with the wavefront renderer and adds the time of
+// its stages to the JSON. --texture-filter picks the texture map lookups
+// (trilinear by default). --parse-mb sets the size of the generated
+// scene whose load is measured, 1024 for the 1 GB scene.
+//
+// options: [--quick] [--runs N] [--size W H] [--scenes dir] [--json file]
+//          [--order scanline|morton|hilbert|all] [--wavefront]
+//          [--texture-filter nearest|trilinear] [--parse-mb N]
+int run_bench(int argc, char **argv);
+
+#endif
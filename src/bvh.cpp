@@ -0,0 +1,92 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#include "bvh.h"
+#include "timeline.h"
+#include <algorithm>
+
+// max number of primitives in a leaf
+#define BVH_LEAF_SIZE 2
+
+void BVH::build(const std::vector<BBox> &open, const std::vector<BBox> &close, float t0, float t1)
+{
+	TIMELINE_SCOPE("build bvh");
+	nodes.clear();
+	indices.clear();
+	set_time_range(t0, t1);
+
+	if(open.empty())
+		return;
+
+	// primitives are split by their centroid at the middle of the shutter,
+	// so fast moving objects do not drag their neighbours along
+	std::vector<Point> centroids(open.size());
+	for(size_t i = 0; i < open.size(); ++i)
+	{
+		indices.push_back(i);
+		centroids[i] = BBox::lerp(open[i], close[i], 0.5f).centroid();
+	}
+	nodes.reserve(2 * open.size());
+	build_node(open, close, centroids, 0, open.size());
+}
+
+void BVH::set_time_range(float t0, float t1)
+{
+	time0 = t0;
+	time1 = t1;
+	inv_range = (t1 > t0) ? 1.0f / (t1 - t0) : 0.0f;
+}
+
+unsigned int BVH::build_node(const std::vector<BBox> &open, const std::vector<BBox> &close,
+	std::vector<Point> &centroids, unsigned int begin, unsigned int end)
+{
+	unsigned int index = nodes.size();
+	nodes.push_back(BVHNode());
+
+	BBox b0, b1, cb;
+	for(unsigned int i = begin; i < end; ++i)
+	{
+		b0.expand(open[indices[i]]);
+		b1.expand(close[indices[i]]);
+		cb.expand(centroids[indices[i]]);
+	}
+	nodes[index].bounds0 = b0;
+	nodes[index].bounds1 = b1;
+
+	if(end - begin <= BVH_LEAF_SIZE)
+	{
+		nodes[index].offset = begin;
+		nodes[index].count = end - begin;
+		nodes[index].axis = 0;
+		return index;
+	}
+
+	// median split along the axis where the centroids spread the most
+	int axis = cb.largest_axis();
+	unsigned int mid = (begin + end) / 2;
+	std::nth_element(indices.begin() + begin, indices.begin() + mid, indices.begin() + end,
+		[&](unsigned int a, unsigned int b) {
+			return axis_value(centroids[a], axis) < axis_value(centroids[b], axis);
+		});
+
+	// first child follows its parent, the second one is linked by offset
+	build_node(open, close, centroids, begin, mid);
+	unsigned int second = build_node(open, close, centroids, mid, end);
+	nodes[index].offset = second;
+	nodes[index].count = 0;
+	nodes[index].axis = axis;
+	return index;
+}
@@ -0,0 +1,153 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#ifndef BVH_H
+#define BVH_H
+
+#include <vector>
+#include "ray.h"
+#include "math/bbox.h"
+
+// BVH node. Bounds are kept for both ends of the shutter interval
+// and interpolated to the ray time while traversing.
+struct BVHNode
+{
+	BBox bounds0;		// bounds at shutter open
+	BBox bounds1;		// bounds at shutter close
+	unsigned int offset;	// leaf: first primitive index, interior: second child
+	unsigned int count;		// number of primitives, 0 for interior nodes
+	int axis;				// split axis of interior nodes
+};
+
+// Motion bounding volume hierarchy.
+class BVH
+{
+public:
+	BVH() : time0(0), time1(0), inv_range(0) {}
+
+	// build the tree from the primitive bounds at shutter open (time t0)
+	// and close (time t1). Both vectors must have the same size.
+	void build(const std::vector<BBox> &open, const std::vector<BBox> &close, float t0, float t1);
+
+	inline bool empty() const { return nodes.empty(); }
+
+	// shutter interval the node bounds refer to
+	void set_time_range(float t0, float t1);
+
+	// walk the nodes crossed by the ray, front to back. visit(index) is called
+	// for every primitive of the reached leaves and returns true to stop the
+	// traversal. tmax may be shortened by the visitor while walking.
+	template<class Visitor>
+	void traverse(const Ray &ray, const float &tmax, Visitor visit) const;
+
+	// visit every primitive of the leaves whose bounds, at time0, contain
+	// the point. visit(index) returns true to stop the query.
+	template<class Visitor>
+	void query(const Point &p, Visitor visit) const;
+
+	std::vector<BVHNode> nodes;
+	std::vector<unsigned int> indices;	// primitive indices referenced by leaves
+	float time0, time1;
+
+private:
+	float inv_range;
+
+	unsigned int build_node(const std::vector<BBox> &open, const std::vector<BBox> &close,
+		std::vector<Point> &centroids, unsigned int begin, unsigned int end);
+};
+
+template<class Visitor>
+void BVH::traverse(const Ray &ray, const float &tmax, Visitor visit) const
+{
+	if(nodes.empty())
+		return;
+
+	// fraction of the shutter interval at the ray time
+	float s = (ray.time - time0) * inv_range;
+	s = std::min(1.0f, std::max(0.0f, s));
+
+	Vector inv_dir(1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z);
+	bool dir_neg[3] = { inv_dir.x < 0, inv_dir.y < 0, inv_dir.z < 0 };
+
+	unsigned int stack[64];
+	int top = 0;
+	stack[top++] = 0;
+	while(top > 0)
+	{
+		const BVHNode &node = nodes[stack[--top]];
+
+		// trees without motion (time0 == time1) skip the interpolation
+		float tnear;
+		bool crossed = inv_range > 0 ? BBox::lerp(node.bounds0, node.bounds1, s).hit(ray.origin, inv_dir, tmax, tnear)
+			: node.bounds0.hit(ray.origin, inv_dir, tmax, tnear);
+		if(!crossed)
+			continue;
+
+		if(node.count > 0)
+		{
+			for(unsigned int i = 0; i < node.count; ++i)
+				if(visit(indices[node.offset + i]))
+					return;
+		}
+		else
+		{
+			// push the far child first so the near one is visited first
+			unsigned int first = (unsigned int)(&node - &nodes[0]) + 1;
+			if(dir_neg[node.axis])
+			{
+				stack[top++] = first;
+				stack[top++] = node.offset;
+			}
+			else
+			{
+				stack[top++] = node.offset;
+				stack[top++] = first;
+			}
+		}
+	}
+}
+
+template<class Visitor>
+void BVH::query(const Point &p, Visitor visit) const
+{
+	if(nodes.empty())
+		return;
+
+	unsigned int stack[64];
+	int top = 0;
+	stack[top++] = 0;
+	while(top > 0)
+	{
+		unsigned int index = stack[--top];
+		const BVHNode &node = nodes[index];
+		if(!node.bounds0.contains(p))
+			continue;
+
+		if(node.count > 0)
+		{
+			for(unsigned int i = 0; i < node.count; ++i)
+				if(visit(indices[node.offset + i]))
+					return;
+		}
+		else
+		{
+			stack[top++] = node.offset;
+			stack[top++] = index + 1;
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,133 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#include "frameoutput.h"
+#include "timeline.h"
+#include <iostream>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+FrameOutput::~FrameOutput()
+{
+	if(out && out != stdout)
+		fclose(out);
+}
+
+bool FrameOutput::open(const std::string &name, size_t w, size_t h, size_t band_rows, const FramebufferSettings &framebuffer)
+{
+	file = name;
+	width = w;
+	height = h;
+	current = 0;
+	tiled = framebuffer.tiled;
+	streaming = !tiled && band_rows > 0;
+	if(tiled)
+	{
+		rows = height;
+		std::string scratch = (file == "-" ? std::string("framebuffer") : file) + ".tiles";
+		return tiles.create(width, height, framebuffer, scratch) && open_stream();
+	}
+	if(!streaming)
+	{
+		rows = height;
+		image.create((int)width, (int)height);
+		return true;
+	}
+
+	rows = band_rows;
+	band.assign(width * std::min(rows, height), Color());
+	return open_stream();
+}
+
+bool FrameOutput::open_stream()
+{
+	if(file == "-")
+	{
+#ifdef _WIN32
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+		out = stdout;
+	}
+	else
+		out = fopen(file.c_str(), "wb");
+	if(!out)
+	{
+		std::cerr << "Failed to create output file: " << file << std::endl;
+		return false;
+	}
+	bytes.resize(width * 3);
+	fprintf(out, "P6\n%zu %zu\n255\n", width, height);
+	return !ferror(out);
+}
+
+bool FrameOutput::end_band()
+{
+	size_t band_rows = band_height(current++);
+	if(!streaming)
+		return true;
+
+	TIMELINE_SCOPE("write band");
+	for(size_t h = 0; h < band_rows; ++h)
+		if(!write_row(&band[h * width]))
+			return false;
+	// a reader at the other end of a pipe gets every band when it is done
+	return fflush(out) == 0;
+}
+
+bool FrameOutput::write_row(const Color *row)
+{
+	auto to_byte = [](float v) { return (unsigned char)std::max(0, std::min(255, (int)(v * 255))); };
+	for(size_t w = 0; w < width; ++w)
+	{
+		bytes[3 * w] = to_byte(row[w].r);
+		bytes[3 * w + 1] = to_byte(row[w].g);
+		bytes[3 * w + 2] = to_byte(row[w].b);
+	}
+	return fwrite(&bytes[0], 1, bytes.size(), out) == bytes.size();
+}
+
+bool FrameOutput::close()
+{
+	if(!streaming && !tiled)
+		return image.save(file);
+	bool ok = current == num_bands() && !ferror(out);
+	if(tiled && ok)
+	{
+		TIMELINE_SCOPE("write tiles");
+		tiles.flush();
+		std::vector<Color> row(width);
+		for(size_t h = 0; h < height && ok; ++h)
+		{
+			tiles.read_row(h, &row[0]);
+			ok = write_row(&row[0]);
+		}
+		ok = ok && fflush(out) == 0;
+		tiles.close();
+	}
+	if(out != stdout && fclose(out) != 0)
+		ok = false;
+	out = NULL;
+	return ok;
+}
+
+void FrameOutput::print(std::ostream &out) const
+{
+	if(tiled)
+		tiles.print(out);
+}
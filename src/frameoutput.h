@@ -0,0 +1,92 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#ifndef FRAMEOUTPUT_H
+#define FRAMEOUTPUT_H
+
+#include "color.h"
+#include "ppmimage.h"
+#include "tiledframebuffer.h"
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// rows of a band when streaming without a given height
+#define DEFAULT_BAND_ROWS 64
+
+// Where a render puts its pixels. By default the whole image is kept and
+// saved as a text PPM (P3) once done. Streaming keeps one band of rows
+// only: every finished band is converted to 8 bits and appended to a
+// binary PPM (P6), the file or stdout when it is named "-", so the memory
+// used does not grow with the image. A tiled framebuffer keeps the image
+// in a scratch file next to the output, with a bounded working set in
+// memory, and writes the P6 by streaming through its tiles once done.
+class FrameOutput
+{
+public:
+	FrameOutput() : width(0), height(0), rows(0), streaming(false), tiled(false), current(0), out(NULL) {}
+	~FrameOutput();
+
+	// band_rows 0 keeps the whole image in a single band
+	bool open(const std::string &file, size_t width, size_t height, size_t band_rows, 
+		const FramebufferSettings &framebuffer = FramebufferSettings());
+
+	inline size_t num_bands() const { return rows ? (height + rows - 1) / rows : 0; }
+	inline size_t band_start(size_t band) const { return band * rows; }
+	inline size_t band_height(size_t band) const { return std::min(rows, height - band_start(band)); }
+
+	// h is a row of the image, in the band being rendered
+	inline void set_color(size_t w, size_t h, const Color &c)
+	{
+		if(tiled)
+			tiles.set(w, h, c);
+		else if(streaming)
+			band[(h - band_start(current)) * width + w] = c;
+		else
+			image.set_color((int)w, (int)h, c);
+	}
+
+	// the band being rendered is done, streaming appends it to the output
+	bool end_band();
+	// saves the image, or ends the stream
+	bool close();
+
+	// framebuffer use, nothing for the other outputs
+	void print(std::ostream &out) const;
+
+private:
+	bool open_stream();
+	bool write_row(const Color *row);
+
+	std::string file;
+	size_t width;
+	size_t height;
+	size_t rows;
+	bool streaming;
+	bool tiled;
+	size_t current;
+	// whole image
+	PPMImage image;
+	// streaming
+	std::vector<Color> band;
+	std::vector<unsigned char> bytes;
+	FILE *out;
+	// tiled
+	TiledFramebuffer tiles;
+};
+
+#endif
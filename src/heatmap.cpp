@@ -0,0 +1,125 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#include "heatmap.h"
+#include "timeline.h"
+#include <algorithm>
+#include <fstream>
+#include <stdint.h>
+
+// costs above this percentile get the hottest color, so a few outliers do
+// not leave the rest of the image dark
+#define HEATMAP_PERCENTILE 0.995f
+
+void Heatmap::create(size_t w, size_t h)
+{
+	width = w;
+	height = h;
+	PixelCost zero = { 0, 0, 0 };
+	data.assign(width * height, zero);
+}
+
+HeatmapMetric Heatmap::parse_metric(const std::string &name)
+{
+	if(name == "time")
+		return HeatmapTime;
+	if(name == "rays")
+		return HeatmapRays;
+	if(name == "tests")
+		return HeatmapHitTests;
+	return HeatmapNone;
+}
+
+float Heatmap::value(const PixelCost &cost, HeatmapMetric metric) const
+{
+	switch(metric)
+	{
+	case HeatmapRays:
+		return cost.rays;
+	case HeatmapHitTests:
+		return cost.hit_tests;
+	default:
+		return cost.nanoseconds;
+	}
+}
+
+bool Heatmap::save(const std::string &output, HeatmapMetric metric) const
+{
+	TIMELINE_SCOPE("save heatmap");
+	std::string base = output;
+	size_t dot = base.find_last_of('.');
+	if(dot != std::string::npos && base.find_first_of("/\\", dot) == std::string::npos)
+		base.erase(dot);
+	return save_false_color(base + ".heat.ppm", metric) && save_raw(base + ".heat.pfm");
+}
+
+// black, blue, cyan, green, yellow, red, white: cheap to expensive
+static Color false_color(float t)
+{
+	static const Color ramp[] = { Color(0, 0, 0), Color(0, 0, 1), Color(0, 1, 1), Color(0, 1, 0),
+		Color(1, 1, 0), Color(1, 0, 0), Color(1, 1, 1) };
+	const int last = sizeof(ramp) / sizeof(ramp[0]) - 1;
+	t = std::min(std::max(t, 0.0f), 1.0f) * last;
+	int i = std::min((int)t, last - 1);
+	float f = t - i;
+	return ramp[i] * (1 - f) + ramp[i + 1] * f;
+}
+
+bool Heatmap::save_false_color(const std::string &file, HeatmapMetric metric) const
+{
+	std::vector<float> values(data.size());
+	for(size_t i = 0; i < data.size(); ++i)
+		values[i] = value(data[i], metric);
+	float hottest = 0;
+	if(!values.empty())
+	{
+		std::vector<float> sorted(values);
+		size_t k = (size_t)((sorted.size() - 1) * HEATMAP_PERCENTILE);
+		std::nth_element(sorted.begin(), sorted.begin() + k, sorted.end());
+		hottest = sorted[k];
+	}
+	float scale = hottest > 0 ? 1 / hottest : 0;
+
+	std::ofstream out(file.c_str());
+	if(!out)
+	{
+		std::cerr << "Failed to create heatmap file: " << file << std::endl;
+		return false;
+	}
+	out << "P3" << std::endl;
+	out << width << " " << height << std::endl;
+	out << "255" << std::endl;
+	for(size_t i = 0; i < values.size(); ++i)
+		out << false_color(values[i] * scale);
+	return true;
+}
+
+bool Heatmap::save_raw(const std::string &file) const
+{
+	std::ofstream out(file.c_str(), std::ios::binary);
+	if(!out)
+	{
+		std::cerr << "Failed to create heatmap file: " << file << std::endl;
+		return false;
+	}
+	// PFM: a negative scale means little endian floats, rows bottom to top
+	const uint16_t probe = 1;
+	bool little_endian = *(const uint8_t*)&probe == 1;
+	out << "PF\n" << width << " " << height << "\n" << (little_endian ? "-1.0" : "1.0") << "\n";
+	for(size_t h = height; h-- > 0;)
+		out.write((const char*)&data[h * width], width * sizeof(PixelCost));
+	return true;
+}
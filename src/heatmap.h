@@ -0,0 +1,68 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#ifndef HEATMAP_H
+#define HEATMAP_H
+
+#include "color.h"
+#include <string>
+#include <vector>
+
+// what the false color image of the heatmap shows
+enum HeatmapMetric
+{
+	HeatmapNone,
+	HeatmapTime,		// nanoseconds spent on the pixel
+	HeatmapRays,		// rays traced for the pixel, of any type
+	HeatmapHitTests		// hit_test calls made for the pixel
+};
+
+// measured render cost of one pixel
+struct PixelCost
+{
+	float nanoseconds;
+	float rays;
+	float hit_tests;
+};
+
+// Render cost of every pixel of an image. Saved next to the image as a
+// false color PPM of one metric and a PFM with the raw values of all of
+// them (r: nanoseconds, g: rays, b: hit tests).
+class Heatmap
+{
+public:
+	Heatmap() : width(0), height(0) {}
+
+	void create(size_t width, size_t height);
+	inline void set(size_t w, size_t h, const PixelCost &cost) { data[h * width + w] = cost; }
+
+	// output.ppm is saved as output.heat.ppm and output.heat.pfm
+	bool save(const std::string &output, HeatmapMetric metric) const;
+
+	// parse "time", "rays" or "tests"
+	static HeatmapMetric parse_metric(const std::string &name);
+
+private:
+	std::vector<PixelCost> data;
+	size_t width;
+	size_t height;
+
+	float value(const PixelCost &cost, HeatmapMetric metric) const;
+	bool save_false_color(const std::string &file, HeatmapMetric metric) const;
+	bool save_raw(const std::string &file) const;
+};
+
+#endif
@@ -0,0 +1,126 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#include "instance.h"
+
+//////////////////////////////////////////////////////////
+/// Shape group
+//////////////////////////////////////////////////////////
+
+void ShapeGroup::build()
+{
+	std::vector<BBox> boxes;
+	bvh_shapes.clear();
+	unbounded.clear();
+	for(size_t i = 0; i < shapes.size(); ++i)
+	{
+		BBox b = shapes[i]->bounds();
+		if(b.bounded())
+		{
+			boxes.push_back(b);
+			bvh_shapes.push_back(i);
+		}
+		else
+			unbounded.push_back(i);
+	}
+	// the shapes are static in the group space
+	bvh.build(boxes, boxes, 0, 0);
+}
+
+BBox ShapeGroup::bounds() const
+{
+	if(!unbounded.empty())
+		return BBox::infinite();
+	return bvh.empty() ? BBox() : bvh.nodes[0].bounds0;
+}
+
+float ShapeGroup::hit_test(const Ray &ray, Vector &normal, const Point *max_pos, bool *inside) const
+{
+	// the shapes reject hits past max_pos, it also bounds the traversal
+	float closest_t = FLT_MAX;
+	if(max_pos)
+	{
+		double max_t = (max_pos->x - ray.origin.x) / ray.direction.x;
+		if(max_t < FLT_MAX)
+			closest_t = (float)max_t;
+	}
+
+	bool found = false;
+	auto test = [&](unsigned int i)
+	{
+		Vector n;
+		bool in = false;
+		float t = shapes[i]->hit_test(ray, n, max_pos, &in);
+		if(t > FLT_EPSILON && t < closest_t)
+		{
+			closest_t = t;
+			normal = n;
+			if(inside)
+				*inside = in;
+			found = true;
+		}
+		return false;
+	};
+
+	for(size_t i = 0; i < unbounded.size(); ++i)
+		test(unbounded[i]);
+	bvh.traverse(ray, closest_t, [&](unsigned int i) { return test(bvh_shapes[i]); });
+
+	return found ? closest_t : -1.0f;
+}
+
+//////////////////////////////////////////////////////////
+/// Instance
+//////////////////////////////////////////////////////////
+
+InstanceObject::InstanceObject()
+{
+	type = Instance;
+}
+
+void InstanceObject::calculate_matrices(float dt)
+{
+	calculate_transform(dt);
+}
+
+BBox InstanceObject::bounds()
+{
+	BBox b = group->bounds();
+	if(!b.bounded())
+		return b;
+	return transform_bounds(b);
+}
+
+float InstanceObject::hit_test(const Ray &ray, Vector &normal, const Point *max_pos, bool *inside)
+{
+	// shapes measure t along a unit direction, it is scaled back to the
+	// world ray on return
+	Ray inv_ray(mul_point(inv_trans, ray.origin), mul_vec(inv_trans, ray.direction), ray.time, ray.sample);
+	float length = inv_ray.direction.length();
+	inv_ray.direction = inv_ray.direction * (1.0f / length);
+
+	Point inv_max;
+	if(max_pos)
+		inv_max = mul_point(inv_trans, *max_pos);
+
+	float t = group->hit_test(inv_ray, normal, max_pos ? &inv_max : NULL, inside);
+	if(t < 0)
+		return -1.0f;
+
+	normal = mul_normal(inv_trans, normal);
+	normal.normalize();
+	return t / length;
+}
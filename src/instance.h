@@ -0,0 +1,70 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#ifndef INSTANCE_H
+#define INSTANCE_H
+
+#include <vector>
+#include <memory>
+#include "object.h"
+#include "bvh.h"
+#include "arena.h"
+
+// Shapes defined once in their own space and placed in the scene by any
+// number of instances. The group owns its shapes, they do not move.
+class ShapeGroup
+{
+public:
+	ShapeGroup() : id(0) {}
+
+	// build the hierarchy over the bounded shapes
+	void build();
+
+	// closest hit among the shapes, same contract as Object::hit_test
+	float hit_test(const Ray &ray, Vector &normal, const Point *max_pos = NULL, bool *inside = NULL) const;
+	BBox bounds() const;
+
+	size_t id;
+	// the shapes live in the group arena
+	Arena arena;
+	std::vector<Object*> shapes;
+	BVH bvh;
+	std::vector<unsigned int> bvh_shapes;	// shape of every bvh primitive
+	std::vector<unsigned int> unbounded;	// shapes tested outside the bvh
+
+private:
+	// not copyable, it owns its shapes
+	ShapeGroup(const ShapeGroup &);
+	ShapeGroup &operator=(const ShapeGroup &);
+};
+
+// A shape group placed by the object transform. Instances share the
+// group, so they only cost their transform and material.
+class InstanceObject : public Object
+{
+public:
+	InstanceObject();
+
+	void calculate_matrices(float dt = 0) override;
+
+	BBox bounds() override;
+
+	float hit_test(const Ray &ray, Vector &normal, const Point *max_pos = NULL, bool *inside = NULL) override;
+
+	std::shared_ptr<ShapeGroup> group;
+};
+
+#endif
@@ -17,9 +17,11 @@
 #include "light.h"
 #include "multijittered.h"
 #include <string>
+#include <cfloat>
+#include <algorithm>
 
 Light::Light()
-	: type(LightAreaType::LAT_NoArea), area_size(0), num_samples(0), sampler(NULL)
+	: type(LightAreaType::LAT_NoArea), area_size(0), num_samples(0), num_sets(1), id(0), range(FLT_MAX)
 {
 
 }
@@ -29,64 +31,102 @@ Light::~Light()
 
 }
 
-void Light::build_area(std::string stype)
+bool Light::build_area(const std::string &stype)
 {
-	half_area_size = area_size/2;
-
-
-	sampler = new MultiJittered(num_samples);
 	if( stype == "noarea")
-	{
-		num_samples = 1;
-		type = LAT_NoArea;
-	}
+		build_area(LAT_NoArea);
 	else if(stype == "square")
-	{
-		type = LAT_Square;
-	}
+		build_area(LAT_Square);
 	else if(stype == "sphere")
-	{
-		type = LAT_Sphere;
-		sampler->map_samples_to_sphere();
-	}
+		build_area(LAT_Sphere);
 	else if(stype == "disk")
-	{
-		type = LAT_Disk;
-		sampler->map_samples_to_unit_disk();
-	}
+		build_area(LAT_Disk);
 	else if(stype == "hemisphere")
-	{
-		type = LAT_Hemisphere;
-		sampler->map_samples_to_hemisphere(1);
-	}
+		build_area(LAT_Hemisphere);
 	else
 	{
-		 printf("invalid light type (%s)", stype.c_str());
+		build_area(LAT_NoArea);
+		return false;
 	}
+	return true;
 }
 
-Point Light::get_point()
+void Light::build_area(LightAreaType area_type)
 {
-	//if(num_samples == 1 || type == LAT_NoArea)
-	//	return pos;
+	half_area_size = area_size/2;
+	type = area_type;
 
-	Point dp;
+	MultiJittered sampler(num_samples);
+	const std::vector<Point> *area = NULL;
 	switch (type)
 	{
 	case LAT_Square:
-		dp = sampler->sample_unit_square();
-		break;
-	case LAT_Disk:
-		dp = sampler->sample_unit_disk();
+		area = &sampler.get_unit_square_samples();
 		break;
 	case LAT_Sphere:
-		dp = sampler->sample_sphere();
+		sampler.map_samples_to_sphere();
+		area = &sampler.get_sphere_samples();
+		break;
+	case LAT_Disk:
+		sampler.map_samples_to_unit_disk();
+		area = &sampler.get_disk_samples();
 		break;
 	case LAT_Hemisphere:
-		dp = sampler->sample_hemisphere();
+		sampler.map_samples_to_hemisphere(1);
+		area = &sampler.get_hemisphere_samples();
 		break;
+	default:
+		num_samples = 1;
+		break;
+	}
+
+	// sample positions are computed once, scaled and moved to the light
+	// position, so shading just walks the set of its pixel sample
+	points.clear();
+	if(!area)
+	{
+		num_sets = 1;
+		points.push_back(pos);
+		return;
 	}
-	Point lp = (dp * area_size);
-	Point fpos = Point(pos.x + lp.x, pos.y + lp.y, pos.z + lp.z); 
-	return fpos; 
+
+	num_sets = sampler.get_num_sets();
+	points.reserve(area->size());
+	for(size_t i = 0; i < area->size(); ++i)
+	{
+		Point lp = (*area)[i] * area_size;
+		points.push_back(Point(pos.x + lp.x, pos.y + lp.y, pos.z + lp.z));
+	}
+}
+
+void Light::compute_range(float cutoff)
+{
+	// brightest channel after attenuation: i / (a + b*d + c*d^2)
+	float i = std::max(color.r, std::max(color.g, color.b));
+	float k = i / cutoff - att.a;
+
+	// never brighter than the cutoff, not even at the light position
+	if(k <= 0)
+	{
+		range = 0;
+		return;
+	}
+
+	float d;
+	if(att.c > 0)
+		d = (-att.b + std::sqrt(att.b * att.b + 4 * att.c * k)) / (2 * att.c);
+	else if(att.b > 0)
+		d = k / att.b;
+	else
+	{
+		// no falloff, it reaches the whole scene
+		range = FLT_MAX;
+		return;
+	}
+
+	// area samples may be placed away from the light center
+	float extent = 0;
+	for(size_t j = 0; j < points.size(); ++j)
+		extent = std::max(extent, (float)Point::distance(points[j], pos));
+	range = d + extent;
 }
\ No newline at end of file
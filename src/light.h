@@ -19,8 +19,8 @@
 
 #include "math/point.h"
 #include "color.h"
-
-class Sampler;
+#include <string>
+#include <vector>
 
 enum LightAreaType
 {
@@ -45,17 +45,28 @@ class Light
 public:
 	Light();
 	~Light();
-	void build_area(std::string type);
-	Point get_point();
+	// false for an unknown type, which falls back to a point light
+	bool build_area(const std::string &type);
+	void build_area(LightAreaType area_type);
+	// compute the distance where the attenuated light falls below cutoff
+	void compute_range(float cutoff);
+	// the num_samples positions used to shade the given pixel sample
+	inline const Point *get_points(size_t sample) const 
+	{
+		return &points[(sample % num_sets) * num_samples];
+	}
 
     Point pos;			//Light position
     Color color;		//Light color
     Attenuation att;	//Attenuation factor
-	Sampler* sampler;	//Sampler for light area
 	int num_samples;	//Number of samples
 	LightAreaType type;	//Type os areas
 	float area_size;	//Light area size
 	float half_area_size;
+	int num_sets;		//Number of sample sets
+	std::vector<Point> points;	//Sample positions, num_sets * num_samples
+	size_t id;			//Index in the scene light list
+	float range;		//Effective radius around pos, FLT_MAX if unlimited
 };
 
 
@@ -16,12 +16,110 @@
 */
 #include "scene.h"
 #include "raytracer.h"
+#include "bench.h"
+#include "primbench.h"
+#include "timeline.h"
+#include <algorithm>
+#include <cstdlib>
+#include <string>
 
 int main(int argc, char **argv) {
     Scene scene;
-	scene.load_file(argc, argv);
-    
+
+	// benchmark over the bundled scenes, see bench.h for the options
+	if(argc >= 2 && std::string(argv[1]) == "--bench")
+		return run_bench(argc - 2, argv + 2);
+	if(argc >= 2 && std::string(argv[1]) == "--bench-primitives")
+		return run_primitive_bench(argc - 2, argv + 2);
+
+	// scene compiler mode: input.in output.rtsc
+	if(argc == 4 && std::string(argv[1]) == "--compile")
+	{
+		scene.load(argv[2]);
+		return scene.save_binary(argv[3]) ? 0 : 1;
+	}
+
+	// options may follow the usual arguments:
+	// --heatmap [time|rays|tests], --timeline file.json,
+	// --order scanline|morton|hilbert, --wavefront, --stream [rows],
+	// --framebuffer half|rgb9e5 [cache MB], --texture-filter nearest|trilinear
 	Raytracer rt(4);
+	int args = argc;
+	for(int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if(arg != "--heatmap" && arg != "--timeline" && arg != "--order" && arg != "--wavefront" && arg != "--stream" && arg != "--framebuffer" && arg != "--texture-filter")
+			continue;
+		args = std::min(args, i);
+		if(arg == "--timeline" && i + 1 < argc)
+			Timeline::enable(argv[++i]);
+		else if(arg == "--wavefront")
+			rt.wavefront = true;
+		else if(arg == "--stream")
+		{
+			rt.band_rows = DEFAULT_BAND_ROWS;
+			if(i + 1 < argc && atoi(argv[i + 1]) > 0)
+				rt.band_rows = atoi(argv[++i]);
+		}
+		else if(arg == "--texture-filter")
+		{
+			if(i + 1 >= argc || !MipMap::parse_filter(argv[++i], rt.texture_filter))
+			{
+				std::cerr << "--texture-filter takes nearest or trilinear" << std::endl;
+				return 1;
+			}
+		}
+		else if(arg == "--framebuffer")
+		{
+			rt.framebuffer.tiled = true;
+			if(i + 1 >= argc || !FramebufferSettings::parse_storage(argv[++i], rt.framebuffer.storage))
+			{
+				std::cerr << "--framebuffer takes half or rgb9e5" << std::endl;
+				return 1;
+			}
+			if(i + 1 < argc && atoi(argv[i + 1]) > 0)
+				rt.framebuffer.cache_mb = atoi(argv[++i]);
+		}
+		else if(arg == "--order")
+		{
+			if(i + 1 >= argc || !PixelTraversal::parse(argv[++i], rt.order))
+			{
+				std::cerr << "--order takes scanline, morton or hilbert" << std::endl;
+				return 1;
+			}
+		}
+		else if(arg == "--heatmap")
+		{
+			rt.heatmap = HeatmapTime;
+			if(i + 1 < argc && Heatmap::parse_metric(argv[i + 1]) != HeatmapNone)
+				rt.heatmap = Heatmap::parse_metric(argv[++i]);
+		}
+	}
+	// the wavefront renderer works on many pixels at once
+	if(rt.wavefront && rt.heatmap != HeatmapNone)
+	{
+		std::cerr << "--heatmap measures the pixels one by one, it cannot be used with --wavefront" << std::endl;
+		return 1;
+	}
+	if(rt.framebuffer.tiled && rt.band_rows > 0)
+	{
+		std::cerr << "--framebuffer writes the image through its tiles, it cannot be used with --stream" << std::endl;
+		return 1;
+	}
+	// an image piped to stdout is streamed, and the messages go to stderr
+	if(args > 2 && std::string(argv[2]) == "-")
+	{
+		if(rt.heatmap != HeatmapNone)
+		{
+			std::cerr << "--heatmap is saved next to the image, it needs an output file" << std::endl;
+			return 1;
+		}
+		std::cout.rdbuf(std::cerr.rdbuf());
+		if(rt.band_rows == 0 && !rt.framebuffer.tiled)
+			rt.band_rows = DEFAULT_BAND_ROWS;
+	}
+	scene.load_file(args, argv);
+    
 	rt.compute(scene);
 
 	//system("pause");
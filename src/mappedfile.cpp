@@ -0,0 +1,205 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#include "mappedfile.h"
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile()
+	: ptr(NULL), length(0), opened(false), file(INVALID_HANDLE_VALUE), mapping(NULL)
+{}
+
+bool MappedFile::open(const std::string &filename)
+{
+	close();
+	file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, 
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(file, &size))
+	{
+		close();
+		return false;
+	}
+	length = (size_t)size.QuadPart;
+	opened = true;
+	if(length == 0)
+		return true;
+
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if(!mapping)
+	{
+		close();
+		return false;
+	}
+	ptr = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if(!ptr)
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+bool MappedFile::create(const std::string &filename, size_t size)
+{
+	close();
+	file = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 
+		FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+	if(file == INVALID_HANDLE_VALUE)
+		return false;
+	length = size;
+	opened = true;
+	if(length == 0)
+		return true;
+
+	mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, (DWORD)((unsigned long long)size >> 32), (DWORD)size, NULL);
+	if(!mapping)
+	{
+		close();
+		return false;
+	}
+	ptr = (const char*)MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+	if(!ptr)
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::release(size_t offset, size_t size)
+{
+	// the views of a file are trimmed by the system as needed
+}
+
+void MappedFile::close()
+{
+	if(ptr)
+		UnmapViewOfFile(ptr);
+	if(mapping)
+		CloseHandle(mapping);
+	if(file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+	ptr = NULL;
+	mapping = NULL;
+	file = INVALID_HANDLE_VALUE;
+	length = 0;
+	opened = false;
+}
+
+#else
+
+MappedFile::MappedFile()
+	: ptr(NULL), length(0), opened(false), fd(-1)
+{}
+
+bool MappedFile::open(const std::string &filename)
+{
+	close();
+	fd = ::open(filename.c_str(), O_RDONLY);
+	if(fd < 0)
+		return false;
+
+	struct stat st;
+	if(fstat(fd, &st) != 0)
+	{
+		close();
+		return false;
+	}
+	length = (size_t)st.st_size;
+	opened = true;
+	if(length == 0)
+		return true;
+
+	void *p = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	if(p == MAP_FAILED)
+	{
+		close();
+		return false;
+	}
+	// the file is read front to back while loading
+	madvise(p, length, MADV_SEQUENTIAL);
+	ptr = (const char*)p;
+	return true;
+}
+
+bool MappedFile::create(const std::string &filename, size_t size)
+{
+	close();
+	fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if(fd < 0)
+		return false;
+	// the name is not needed anymore, the file goes away with the mapping
+	unlink(filename.c_str());
+	if(ftruncate(fd, (off_t)size) != 0)
+	{
+		close();
+		return false;
+	}
+	length = size;
+	opened = true;
+	if(length == 0)
+		return true;
+
+	void *p = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if(p == MAP_FAILED)
+	{
+		close();
+		return false;
+	}
+	ptr = (const char*)p;
+	return true;
+}
+
+void MappedFile::release(size_t offset, size_t size)
+{
+	if(!ptr || offset >= length)
+		return;
+	// the mapping is shared, the dropped pages are written to the file
+	madvise((void*)(ptr + offset), std::min(size, length - offset), MADV_DONTNEED);
+}
+
+void MappedFile::close()
+{
+	if(ptr)
+		munmap((void*)ptr, length);
+	if(fd >= 0)
+		::close(fd);
+	ptr = NULL;
+	fd = -1;
+	length = 0;
+	opened = false;
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+	close();
+}
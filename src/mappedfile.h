@@ -0,0 +1,62 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+// View of a whole file mapped in memory, read only unless it is a
+// scratch file made by create.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool open(const std::string &filename);
+	// new zero filled file of the given size, mapped for reading and
+	// writing. It is deleted once closed.
+	bool create(const std::string &filename, size_t size);
+	void close();
+	// hands the pages of a range back to the system, the data stays in
+	// the file. The range starts at a page boundary.
+	void release(size_t offset, size_t size);
+
+	inline const char *data() const { return ptr; }
+	// only for files made by create
+	inline char *writable_data() { return const_cast<char*>(ptr); }
+	inline size_t size() const { return length; }
+	inline bool is_open() const { return opened; }
+
+private:
+	const char *ptr;
+	size_t length;
+	bool opened;	// empty files are open but not mapped
+#ifdef _WIN32
+	void *file;
+	void *mapping;
+#else
+	int fd;
+#endif
+
+	// not copyable, it owns the mapping
+	MappedFile(const MappedFile &);
+	MappedFile &operator=(const MappedFile &);
+};
+
+#endif
@@ -0,0 +1,134 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#ifndef MATH_BBOX_H
+#define MATH_BBOX_H
+
+#include <cfloat>
+#include <algorithm>
+#include "point.h"
+#include "vector.h"
+
+// Axis aligned bounding box.
+class BBox 
+{
+public:
+    Point min, max;
+
+	// an empty box, it grows as points are added
+    BBox()
+        : min(FLT_MAX, FLT_MAX, FLT_MAX), max(-FLT_MAX, -FLT_MAX, -FLT_MAX)
+	{}
+
+    BBox(const Point &_min, const Point &_max)
+        : min(_min), max(_max)
+	{}
+
+	// a box covering the whole space, used by unbounded objects
+	static BBox infinite()
+	{
+		return BBox(Point(-FLT_MAX, -FLT_MAX, -FLT_MAX), Point(FLT_MAX, FLT_MAX, FLT_MAX));
+	}
+
+	inline bool empty() const
+	{
+		return min.x > max.x || min.y > max.y || min.z > max.z;
+	}
+
+	inline bool bounded() const
+	{
+		return	min.x > -FLT_MAX && min.y > -FLT_MAX && min.z > -FLT_MAX &&
+				max.x < FLT_MAX && max.y < FLT_MAX && max.z < FLT_MAX;
+	}
+
+	inline bool contains(const Point &p) const
+	{
+		return	p.x >= min.x && p.x <= max.x &&
+				p.y >= min.y && p.y <= max.y &&
+				p.z >= min.z && p.z <= max.z;
+	}
+
+	inline BBox &expand(const Point &p)
+	{
+		min.x = std::min(min.x, p.x);	max.x = std::max(max.x, p.x);
+		min.y = std::min(min.y, p.y);	max.y = std::max(max.y, p.y);
+		min.z = std::min(min.z, p.z);	max.z = std::max(max.z, p.z);
+		return *this;
+	}
+
+	inline BBox &expand(const BBox &b)
+	{
+		min.x = std::min(min.x, b.min.x);	max.x = std::max(max.x, b.max.x);
+		min.y = std::min(min.y, b.min.y);	max.y = std::max(max.y, b.max.y);
+		min.z = std::min(min.z, b.min.z);	max.z = std::max(max.z, b.max.z);
+		return *this;
+	}
+
+	inline Point centroid() const
+	{
+		return Point(0.5f * (min.x + max.x), 0.5f * (min.y + max.y), 0.5f * (min.z + max.z));
+	}
+
+	// axis (0 = x, 1 = y, 2 = z) where the box is longer
+	inline int largest_axis() const
+	{
+		Vector d = max - min;
+		if(d.x >= d.y && d.x >= d.z)
+			return 0;
+		return d.y >= d.z ? 1 : 2;
+	}
+
+	// linear interpolation between two boxes, t in [0, 1]
+	static inline BBox lerp(const BBox &b0, const BBox &b1, float t)
+	{
+		float s = 1.0f - t;
+		return BBox(Point(s * b0.min.x + t * b1.min.x, s * b0.min.y + t * b1.min.y, s * b0.min.z + t * b1.min.z),
+					Point(s * b0.max.x + t * b1.max.x, s * b0.max.y + t * b1.max.y, s * b0.max.z + t * b1.max.z));
+	}
+
+	// slab test. inv_dir holds the reciprocal of the ray direction.
+	// returns true if the ray crosses the box between 0 and tmax
+	inline bool hit(const Point &ori, const Vector &inv_dir, float tmax, float &tnear) const
+	{
+		float t0 = 0.0f, t1 = tmax;
+
+		float ta = (min.x - ori.x) * inv_dir.x;
+		float tb = (max.x - ori.x) * inv_dir.x;
+		t0 = std::max(t0, std::min(ta, tb));
+		t1 = std::min(t1, std::max(ta, tb));
+
+		ta = (min.y - ori.y) * inv_dir.y;
+		tb = (max.y - ori.y) * inv_dir.y;
+		t0 = std::max(t0, std::min(ta, tb));
+		t1 = std::min(t1, std::max(ta, tb));
+
+		ta = (min.z - ori.z) * inv_dir.z;
+		tb = (max.z - ori.z) * inv_dir.z;
+		t0 = std::max(t0, std::min(ta, tb));
+		t1 = std::min(t1, std::max(ta, tb));
+
+		tnear = t0;
+		return t0 <= t1;
+	}
+};
+
+// coordinate of a point along an axis (0 = x, 1 = y, 2 = z)
+inline float axis_value(const Point &p, int axis)
+{
+	return axis == 0 ? p.x : (axis == 1 ? p.y : p.z);
+}
+
+#endif
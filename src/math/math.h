@@ -36,6 +36,17 @@ const double 	TWO_PI 		= 6.2831853071795864769;
 
 #define	IsZero(x)	((x) > -EQN_EPS && (x) < EQN_EPS)
 
+/// Threshold under which the polynomial solvers take a value as zero. 
+/// EQN_EPS underflows in single precision, so floats use their own.
+template<class T>
+inline T eqn_eps() { return (T)EQN_EPS; }
+
+template<>
+inline float eqn_eps<float>() { return 1e-30f; }
+
+template<class T>
+inline bool eqn_is_zero(T x) { return x > -eqn_eps<T>() && x < eqn_eps<T>(); }
+
 inline double toRads(double degrees) 
 {
     return degrees * (M_PI / 180.0);
@@ -46,9 +57,10 @@ inline double toDegrees(double rads)
     return rads * (180.0 / M_PI);
 }
 
-inline int solveQuadric(double c[3], double s[2]) 
+template<class T>
+inline int solveQuadric(T c[3], T s[2]) 
 {
-    double p, q, D;
+    T p, q, D;
 
     /* normal form: x^2 + px + q = 0 */
 
@@ -57,12 +69,12 @@ inline int solveQuadric(double c[3], double s[2])
 
     D = p * p - q;
 
-    if (IsZero(D)) {
+    if (eqn_is_zero(D)) {
 	s[ 0 ] = - p;
 	return 1;
     }
     else if (D > 0) {
-	double sqrt_D = sqrt(D);
+	T sqrt_D = std::sqrt(D);
 
 	s[ 0 ] =   sqrt_D - p;
 	s[ 1 ] = - sqrt_D - p;
@@ -73,13 +85,14 @@ inline int solveQuadric(double c[3], double s[2])
 }
 
 
-inline int solveCubic(double c[4], double s[3]) 
+template<class T>
+inline int solveCubic(T c[4], T s[3]) 
 {
     int     i, num;
-    double  sub;
-    double  A, B, C;
-    double  sq_A, p, q;
-    double  cb_p, D;
+    T  sub;
+    T  A, B, C;
+    T  sq_A, p, q;
+    T  cb_p, D;
 
     /* normal form: x^3 + Ax^2 + Bx + C = 0 */
 
@@ -91,24 +104,24 @@ inline int solveCubic(double c[4], double s[3])
 	x^3 +px + q = 0 */
 
     sq_A = A * A;
-    p = 1.0/3 * (- 1.0/3 * sq_A + B);
-    q = 1.0/2 * (2.0/27 * A * sq_A - 1.0/3 * A * B + C);
+    p = T(1.0/3) * (- T(1.0/3) * sq_A + B);
+    q = T(1.0/2) * (T(2.0/27) * A * sq_A - T(1.0/3) * A * B + C);
 
     /* use Cardano's formula */
 
     cb_p = p * p * p;
     D = q * q + cb_p;
 
-    if (IsZero(D))
+    if (eqn_is_zero(D))
 	{
-		if (IsZero(q)) /* one triple solution */
+		if (eqn_is_zero(q)) /* one triple solution */
 		{ 
 		    s[ 0 ] = 0;
 		    num = 1;
 		}
-		else /* one single and one double solution */
+		else /* one single and one T solution */
 		{ 
-			double u = cbrt(-q);
+			T u = T(cbrt(-q));
 			s[ 0 ] = 2 * u;
 			s[ 1 ] = - u;
 			num = 2;
@@ -116,19 +129,19 @@ inline int solveCubic(double c[4], double s[3])
     }
     else if (D < 0) /* Casus irreducibilis: three real solutions */
 	{ 
-		double phi = 1.0/3 * acos(-q / sqrt(-cb_p));
-		double t = 2 * sqrt(-p);
+		T phi = T(1.0/3) * std::acos(-q / std::sqrt(-cb_p));
+		T t = 2 * std::sqrt(-p);
 
-		s[ 0 ] =   t * cos(phi);
-		s[ 1 ] = - t * cos(phi + M_PI / 3);
-		s[ 2 ] = - t * cos(phi - M_PI / 3);
+		s[ 0 ] =   t * std::cos(phi);
+		s[ 1 ] = - t * std::cos(phi + T(M_PI / 3));
+		s[ 2 ] = - t * std::cos(phi - T(M_PI / 3));
 		num = 3;
     }
     else /* one real solution */
 	{ 
-		double sqrt_D = sqrt(D);
-		double u = cbrt(sqrt_D - q);
-		double v = - cbrt(sqrt_D + q);
+		T sqrt_D = std::sqrt(D);
+		T u = T(cbrt(sqrt_D - q));
+		T v = - T(cbrt(sqrt_D + q));
 
 		s[ 0 ] = u + v;
 		num = 1;
@@ -136,7 +149,7 @@ inline int solveCubic(double c[4], double s[3])
 
     /* resubstitute */
 
-    sub = 1.0/3 * A;
+    sub = T(1.0/3) * A;
 
     for (i = 0; i < num; ++i)
 	s[ i ] -= sub;
@@ -144,12 +157,13 @@ inline int solveCubic(double c[4], double s[3])
     return num;
 }
 
-inline int solveQuartic(double c[5], double s[4]) 
+template<class T>
+inline int solveQuartic(T c[5], T s[4]) 
 {
-    double  coeffs[4];
-    double  z, u, v, sub;
-    double  A, B, C, D;
-    double  sq_A, p, q, r;
+    T  coeffs[4];
+    T  z, u, v, sub;
+    T  A, B, C, D;
+    T  sq_A, p, q, r;
     int     i, num;
 
     /* normal form: x^4 + Ax^3 + Bx^2 + Cx + D = 0 */
@@ -161,11 +175,11 @@ inline int solveQuartic(double c[5], double s[4])
     /*  substitute x = y - A/4 to eliminate cubic term:
 	x^4 + px^2 + qx + r = 0 */
     sq_A = A * A;
-    p = - 3.0/8 * sq_A + B;
-    q = 1.0/8 * sq_A * A - 1.0/2 * A * B + C;
-    r = - 3.0/256*sq_A*sq_A + 1.0/16*sq_A*B - 1.0/4*A*C + D;
+    p = - T(3.0/8) * sq_A + B;
+    q = T(1.0/8) * sq_A * A - T(1.0/2) * A * B + C;
+    r = - T(3.0/256)*sq_A*sq_A + T(1.0/16)*sq_A*B - T(1.0/4)*A*C + D;
 
-    if (IsZero(r)) 
+    if (eqn_is_zero(r)) 
 	{
 		/* no absolute term: y(y^3 + py + q) = 0 */
 		coeffs[ 0 ] = q;
@@ -180,9 +194,9 @@ inline int solveQuartic(double c[5], double s[4])
     else 
 	{
 		/* solve the resolvent cubic ... */
-		coeffs[ 0 ] = 1.0/2 * r * p - 1.0/8 * q * q;
+		coeffs[ 0 ] = T(1.0/2) * r * p - T(1.0/8) * q * q;
 		coeffs[ 1 ] = - r;
-		coeffs[ 2 ] = - 1.0/2 * p;
+		coeffs[ 2 ] = - T(1.0/2) * p;
 		coeffs[ 3 ] = 1;
 		
 		(void) solveCubic(coeffs, s);
@@ -194,17 +208,17 @@ inline int solveQuartic(double c[5], double s[4])
 		u = z * z - r;
 		v = 2 * z - p;
 
-		if (IsZero(u))
+		if (eqn_is_zero(u))
 		    u = 0;
 		else if (u > 0)
-		    u = sqrt(u);
+		    u = std::sqrt(u);
 		else
 		    return 0;
 
-		if (IsZero(v))
+		if (eqn_is_zero(v))
 		    v = 0;
 		else if (v > 0)
-		    v = sqrt(v);
+		    v = std::sqrt(v);
 		else
 		    return 0;
 
@@ -222,7 +236,7 @@ inline int solveQuartic(double c[5], double s[4])
 	}
 
     /* resubstitute */
-    sub = 1.0/4 * A;
+    sub = T(1.0/4) * A;
 
     for (i = 0; i < num; ++i)
 		s[ i ] -= sub;
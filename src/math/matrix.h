@@ -26,10 +26,11 @@
 #include <string>
 #include <sstream>
 
-class Matrix4x4 
+template<class T>
+class Matrix4x4T 
 {
     /// The data of the matrix.
-    float m[4][4];
+    T m[4][4];
 
 public:
 
@@ -45,78 +46,109 @@ public:
             }
 	}
 
-	inline void fill(float v)
+	inline void fill(T v)
 	{
 		 for(size_t i = 0; i < 4; ++i) 
             for(size_t j = 0; j < 4; ++j) 
                 m[i][j] = v;
 	}
 
-    inline float *operator[](int index) 
+    inline T *operator[](int index) 
 	{
         return m[index];
     }
 
 
-    inline const float *operator[](int index) const 
+    inline const T *operator[](int index) const 
 	{
         return m[index];
     }
 
    
-    inline float &at(int row, int column) 
+    inline T &at(int row, int column) 
 	{
         if(row >= 4 || column >= 4)
             throw std::out_of_range("Trying to access invalid matrix position.");
         return m[row][column];
     }
 
-    inline const float &at(int row, int column) const 
+    inline const T &at(int row, int column) const 
 	{
         if(row >= 4 || column >= 4)
             throw std::out_of_range("Trying to access invalid matrix position.");
         return m[row][column];
     }
 
-    Matrix4x4 &operator+=(const Matrix4x4 &right) 
+    Matrix4x4T &operator+=(const Matrix4x4T &right) 
 	{
         for(int i = 0; i < 4; ++i) 
             for(int j = 0; j < 4; ++j) 
                 m[i][j] += right[i][j];
+        return *this;
     }
 
 
-    Matrix4x4 &operator-=(const Matrix4x4 &right) 
+    Matrix4x4T &operator-=(const Matrix4x4T &right) 
 	{
         for(int i = 0; i < 4; ++i) 
             for(int j = 0; j < 4; ++j) 
                 m[i][j] -= right[i][j];
+        return *this;
     }
 
-    Matrix4x4 &operator*=(float right)
+    Matrix4x4T &operator*=(T right)
 	{
         for(int i = 0; i < 4; ++i) 
             for(int j = 0; j < 4; ++j) 
                 m[i][j] *= right;
+        return *this;
     }
 
 
-    Matrix4x4 &operator/=(float right) 
+    Matrix4x4T &operator/=(T right) 
 	{
         for(int i = 0; i < 4; ++i) 
             for(int j = 0; j < 4; ++j) 
                 m[i][j] /= right;
+        return *this;
     }
 
 
-    Matrix4x4 &operator*=(const Matrix4x4 &right)
+    Matrix4x4T &operator*=(const Matrix4x4T &right)
 	{
         for(size_t i = 0; i < 4; ++i)
             for(size_t j = 0; j < 4; ++j)
                 for(size_t k = 0; k < 4; ++k)
                     m[i][k] *= right[k][j];
+        return *this;
     }
 
+	// inverse of an affine transform (rotation, scale and translation)
+	Matrix4x4T affine_inverse() const
+	{
+		T det =	m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+					m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+					m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+		T inv_det = 1 / det;
+
+		Matrix4x4T r;
+		r.identity();
+		r[0][0] = (m[1][1] * m[2][2] - m[1][2] * m[2][1]) * inv_det;
+		r[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * inv_det;
+		r[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * inv_det;
+		r[1][0] = (m[1][2] * m[2][0] - m[1][0] * m[2][2]) * inv_det;
+		r[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * inv_det;
+		r[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * inv_det;
+		r[2][0] = (m[1][0] * m[2][1] - m[1][1] * m[2][0]) * inv_det;
+		r[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * inv_det;
+		r[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * inv_det;
+
+		// inverse translation
+		for(int i = 0; i < 3; ++i)
+			r[i][3] = -(r[i][0] * m[0][3] + r[i][1] * m[1][3] + r[i][2] * m[2][3]);
+		return r;
+	}
+
 	std::string print() 
 	{
 		std::stringstream stream;
@@ -132,9 +164,12 @@ public:
 	}
 };
 
-inline Matrix4x4 operator*( Matrix4x4 &left,  Matrix4x4 &right) 
+typedef Matrix4x4T<float> Matrix4x4;
+
+template<class T>
+inline Matrix4x4T<T> operator*(const Matrix4x4T<T> &left, const Matrix4x4T<T> &right) 
 {
-    Matrix4x4 m;
+    Matrix4x4T<T> m;
     m.fill(0);
 
     for(int i = 0; i < 4; ++i)
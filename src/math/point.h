@@ -21,24 +21,30 @@
 #include "vector.h"
 
 
-class Point 
+template<class T>
+class PointT 
 {
 
 public:
-    float x, y, z, w;
+	typedef T scalar;
+    T x, y, z, w;
 
-    Point(float x = 0.0f, float y = 0.0f, float z = 0.0f, float w = 1.0f)
+    PointT(T x = 0, T y = 0, T z = 0, T w = 1)
         : x(x), y(y), z(z), w(w)
 	{}
+
+	template<class U>
+	explicit PointT(const PointT<U> &p)
+		: x((T)p.x), y((T)p.y), z((T)p.z), w((T)p.w)
+	{}
 	
-    static double distance(const Point &p1, const Point &p2) 
+    static double distance(const PointT &p1, const PointT &p2) 
 	{
-        return std::sqrt(std::pow(p1.x - p2.x, 2)
-                + std::pow(p1.y - p2.y, 2)
-                + std::pow(p1.z - p2.z, 2));
+		double dx = p1.x - p2.x, dy = p1.y - p2.y, dz = p1.z - p2.z;
+        return std::sqrt(dx * dx + dy * dy + dz * dz);
     }
 
-    Point &operator+=(const Vector &rhv) 
+    PointT &operator+=(const VectorT<T> &rhv) 
 	{
         this->x += rhv.x;
         this->y += rhv.y;
@@ -47,7 +53,7 @@ public:
         return *this;
     }
 
-    Point &operator-=(const Vector &rhv) 
+    PointT &operator-=(const VectorT<T> &rhv) 
 	{
         this->x -= rhv.x;
         this->y -= rhv.y;
@@ -57,21 +63,25 @@ public:
     }
 };
 
+typedef PointT<float> Point;
 
 /// + operator for point-vector addition.
-inline Point operator+(Point lhv, const Vector &rhv) 
+template<class T>
+inline PointT<T> operator+(PointT<T> lhv, const VectorT<T> &rhv) 
 {
     lhv += rhv;
     return lhv;
 }
 
-inline Point operator-(Point lhv, const Vector &rhv) 
+template<class T>
+inline PointT<T> operator-(PointT<T> lhv, const VectorT<T> &rhv) 
 {
     lhv -= rhv;
     return lhv;
 }
 
-inline Point operator*(Point lhv, const float &rhv) 
+template<class T>
+inline PointT<T> operator*(PointT<T> lhv, const typename PointT<T>::scalar &rhv) 
 {
     lhv.x *= rhv;
     lhv.y *= rhv;
@@ -79,23 +89,27 @@ inline Point operator*(Point lhv, const float &rhv)
     return lhv;
 }
 
-inline Vector operator-(const Point &lhv, const Point &rhv)
+template<class T>
+inline VectorT<T> operator-(const PointT<T> &lhv, const PointT<T> &rhv)
 {
-    return Vector(lhv.x - rhv.x, lhv.y - rhv.y, lhv.z - rhv.z, lhv.w - rhv.w);
+    return VectorT<T>(lhv.x - rhv.x, lhv.y - rhv.y, lhv.z - rhv.z, lhv.w - rhv.w);
 }
 
-inline bool operator==(const Point &lhv, const Point &rhv) 
+template<class T>
+inline bool operator==(const PointT<T> &lhv, const PointT<T> &rhv) 
 {
     return(lhv.x == rhv.x && lhv.y == rhv.y && lhv.z == rhv.z && lhv.w == rhv.w);
 }
 
-inline bool operator!=(const Point &lhv, const Point &rhv) 
+template<class T>
+inline bool operator!=(const PointT<T> &lhv, const PointT<T> &rhv) 
 {
     return !operator==(lhv, rhv);
 }
 
 
-inline std::ostream &operator<<(std::ostream &stream, const Point &pt) 
+template<class T>
+inline std::ostream &operator<<(std::ostream &stream, const PointT<T> &pt) 
 {
     stream << "(" << pt.x << ", " << pt.y << ", " << pt.z << ", " << pt.w << ")";
     return stream;
@@ -0,0 +1,78 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#ifndef MATH_PRECISION_H
+#define MATH_PRECISION_H
+
+// Precision policies of the intersection kernels. A policy names the scalar
+// type each primitive solves its equation in, the transforms before and the
+// normals after stay in float. The kernels are instantiated for float and
+// double, the build picks the policy hit_test uses:
+// -DRAYTRACER_DOUBLE_PRECISION, -DRAYTRACER_FLOAT_PRECISION or the mixed
+// one by default.
+
+// Float where it matches the double reference of --bench-primitives, double
+// where the equation cancels too many digits: the quartic of the torus and
+// the grazing rays of the cylinder body. The caps of the cylinder are
+// planes, they keep float.
+struct MixedPrecision
+{
+	typedef float sphere;
+	typedef double cylinder;
+	typedef float disk;
+	typedef double torus;
+
+	static const char *name() { return "mixed"; }
+};
+
+struct DoublePrecision
+{
+	typedef double sphere;
+	typedef double cylinder;
+	typedef double disk;
+	typedef double torus;
+
+	static const char *name() { return "double"; }
+};
+
+struct FloatPrecision
+{
+	typedef float sphere;
+	typedef float cylinder;
+	typedef float disk;
+	typedef float torus;
+
+	static const char *name() { return "float"; }
+};
+
+#if defined(RAYTRACER_DOUBLE_PRECISION)
+typedef DoublePrecision KernelPrecision;
+#elif defined(RAYTRACER_FLOAT_PRECISION)
+typedef FloatPrecision KernelPrecision;
+#else
+typedef MixedPrecision KernelPrecision;
+#endif
+
+template<class T>
+inline const char *scalar_name();
+
+template<>
+inline const char *scalar_name<float>() { return "float"; }
+
+template<>
+inline const char *scalar_name<double>() { return "double"; }
+
+#endif
@@ -20,29 +20,38 @@
 #include <iostream>
 #include "math.h"
 
-class Vector 
+// Vector of any scalar type T, see precision.h. The scalar arguments of
+// the operators are not deduced, so a double scales a float vector.
+template<class T>
+class VectorT 
 {
 public:
-    float x, y, z, w;
+	typedef T scalar;
+    T x, y, z, w;
 
-    Vector(float x = 0.0f, float y = 0.0f, float z = 0.0f, float w = 0.0f)
+    VectorT(T x = 0, T y = 0, T z = 0, T w = 0)
         : x(x), y(y), z(z), w(w) 
 	{}
 
-    inline float length() const 
+	template<class U>
+	explicit VectorT(const VectorT<U> &v)
+		: x((T)v.x), y((T)v.y), z((T)v.z), w((T)v.w)
+	{}
+
+    inline T length() const 
 	{
         return std::sqrt( x*x + y*y + z*z);
     }
 
 
-    inline Vector &normalize() 
+    inline VectorT &normalize() 
 	{
-		float norm = length();
+		T norm = length();
         if(norm)	invScale(norm);
         return *this;
     }
 
-	inline Vector &scale(float factor) 
+	inline VectorT &scale(T factor) 
 	{
         x *= factor;
         y *= factor;
@@ -52,7 +61,7 @@ public:
         return *this;
     }
 
-    inline Vector &invScale(float factor) 
+    inline VectorT &invScale(T factor) 
 	{
         x /= factor;
         y /= factor;
@@ -61,15 +70,15 @@ public:
         return *this;
     }
 
-    static inline float dot(const Vector &v1, const Vector &v2) 
+    static inline T dot(const VectorT &v1, const VectorT &v2) 
 	{
         return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z;
     }
 
 
-    static inline Vector cross(const Vector &v1, const Vector &v2)
+    static inline VectorT cross(const VectorT &v1, const VectorT &v2)
 	{
-        return Vector(v1.y * v2.z - v1.z * v2.y,
+        return VectorT(v1.y * v2.z - v1.z * v2.y,
 					v1.z * v2.x - v1.x * v2.z,
 					v1.x * v2.y - v1.y * v2.x);
     }
@@ -87,7 +96,7 @@ public:
     //}
 
     /// += operator for vectors.
-    Vector &operator+=(const Vector &rhv) 
+    VectorT &operator+=(const VectorT &rhv) 
 	{
         x += rhv.x;
         y += rhv.y;
@@ -96,7 +105,7 @@ public:
         return *this;
     }
 
-    Vector &operator-=(const Vector &rhv) 
+    VectorT &operator-=(const VectorT &rhv) 
 	{
         x -= rhv.x;
         y -= rhv.y;
@@ -105,7 +114,7 @@ public:
         return *this;
     }
 
-    Vector &operator-=(const float &rhv) 
+    VectorT &operator-=(const T &rhv) 
 	{
         x -= rhv;
         y -= rhv;
@@ -113,70 +122,79 @@ public:
         return *this;
     }
 
-    Vector &operator*=(const float &factor) 
+    VectorT &operator*=(const T &factor) 
 	{
         this->scale(factor);
         return *this;
     }
 
 
-    Vector &operator/=(const float &factor) 
+    VectorT &operator/=(const T &factor) 
 	{
         this->invScale(factor);
         return *this;
     }
 };
 
+typedef VectorT<float> Vector;
 
-inline Vector operator+(Vector lhv, const Vector &rhv) 
+template<class T>
+inline VectorT<T> operator+(VectorT<T> lhv, const VectorT<T> &rhv) 
 {
     lhv += rhv;
     return lhv;
 }
 
 /// - operator for vectors.
-inline Vector operator-(Vector lhv, const Vector &rhv) 
+template<class T>
+inline VectorT<T> operator-(VectorT<T> lhv, const VectorT<T> &rhv) 
 {
     lhv -= rhv;
     return lhv;
 }
 
 /// - operator for vectors with floats.
-inline Vector operator-(Vector lhv, float rhv) 
+template<class T>
+inline VectorT<T> operator-(VectorT<T> lhv, typename VectorT<T>::scalar rhv) 
 {
     lhv -= rhv;
     return lhv;
 }
 
 /// * operator for scaling vectors.
-inline Vector operator*(Vector lhv, const float &rhv)
+template<class T>
+inline VectorT<T> operator*(VectorT<T> lhv, const typename VectorT<T>::scalar &rhv)
 {
     lhv *= rhv;
     return lhv;
 }
 
 /// * operator for scaling vectors.
-inline Vector operator*(const float &lhv, Vector rhv)
+template<class T>
+inline VectorT<T> operator*(const typename VectorT<T>::scalar &lhv, VectorT<T> rhv)
 {
     rhv *= lhv;
     return rhv;
 }
 
 /// / operator for scaling vectors.
-inline Vector operator/(Vector lhv, const float &rhv)
+template<class T>
+inline VectorT<T> operator/(VectorT<T> lhv, const typename VectorT<T>::scalar &rhv)
 {
     lhv *= rhv;
     return lhv;
 }
 
 /// == operator for vectors.
-inline bool operator==(const Vector &lhv, const Vector &rhv)
+template<class T>
+inline bool operator==(const VectorT<T> &lhv, const VectorT<T> &rhv)
 {
     return (lhv.x == rhv.x && lhv.y == rhv.y && lhv.z == rhv.z && lhv.w == rhv.w);
 }
 
 /// != operator for vectors.
-inline bool operator!=(const Vector &lhv, const Vector &rhv)
+template<class T>
+inline bool operator!=(const VectorT<T> &lhv, const VectorT<T> &rhv)
 {
     return !operator==(lhv, rhv);
 }
@@ -184,7 +202,8 @@ inline bool operator!=(const Vector &lhv, const Vector &rhv)
 /**
  * Operator overloading for writing vectors to output streams.
  **/
-inline std::ostream &operator<<(std::ostream &stream, const Vector &vec)
+template<class T>
+inline std::ostream &operator<<(std::ostream &stream, const VectorT<T> &vec)
 {
     stream << "( " << vec.x << ", " << vec.y << ", " << vec.z << ", " << vec.w << " )";
     return stream;
@@ -0,0 +1,327 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#include "mesh.h"
+#include "mappedfile.h"
+#include "tokenizer.h"
+#include <cmath>
+#include <stdexcept>
+#include <unordered_map>
+
+//////////////////////////////////////////////////////////
+/// OBJ loader
+//////////////////////////////////////////////////////////
+
+// face corner as written in the file, attribute indices start at 0 and
+// are -1 when missing
+struct ObjCorner
+{
+	int p, t, n;
+
+	bool operator==(const ObjCorner &o) const { return p == o.p && t == o.t && n == o.n; }
+};
+
+struct ObjCornerHash
+{
+	size_t operator()(const ObjCorner &c) const
+	{
+		return (size_t)c.p * 73856093u ^ (size_t)c.t * 19349663u ^ (size_t)c.n * 83492791u;
+	}
+};
+
+// value of the current line, missing values are reported at the command
+static float obj_float(Tokenizer &in, const Token &cmd, const char *what)
+{
+	Token tok;
+	if(!in.next_in_line(tok))
+		in.error(cmd, std::string("missing ") + what);
+	return in.parse_float(tok, what);
+}
+
+// OBJ indices start at 1, negative ones count back from the last element read
+static int obj_index(Tokenizer &in, const Token &tok, size_t count, const char *what)
+{
+	int i = in.parse_int(tok, what);
+	long long r = i > 0 ? (long long)i - 1 : (long long)count + i;
+	if(i == 0 || r < 0 || r >= (long long)count)
+		in.error(tok, std::string(what) + " out of range");
+	return (int)r;
+}
+
+// corner written as p, p/t, p//n or p/t/n
+static ObjCorner obj_corner(Tokenizer &in, const Token &tok, size_t num_p, size_t num_t, size_t num_n)
+{
+	ObjCorner c = { -1, -1, -1 };
+	int *fields[3] = { &c.p, &c.t, &c.n };
+	const size_t counts[3] = { num_p, num_t, num_n };
+	static const char *names[3] = { "vertex index", "texture coordinate index", "normal index" };
+
+	Token part = tok;
+	const char *end = tok.ptr + tok.length;
+	for(int f = 0; ; ++f)
+	{
+		if(f == 3)
+			in.error(tok, "invalid face corner");
+		const char *slash = part.ptr;
+		while(slash < end && *slash != '/')
+			++slash;
+		part.length = slash - part.ptr;
+		if(part.length > 0)
+			*fields[f] = obj_index(in, part, counts[f], names[f]);
+		if(slash == end)
+			break;
+		part.column += part.length + 1;
+		part.ptr = slash + 1;
+	}
+	if(c.p < 0)
+		in.error(tok, "face corner without vertex index");
+	return c;
+}
+
+bool TriangleMesh::load_obj(const std::string &file)
+{
+	MappedFile mapped;
+	if(!mapped.open(file))
+		return false;
+	filename = file;
+	Tokenizer in(mapped.data(), mapped.data() + mapped.size(), file);
+
+	// attributes as read, they are indexed separately by the faces
+	std::vector<float> p, t, n;
+	std::vector<ObjCorner> corners;
+	std::unordered_map<ObjCorner, unsigned int, ObjCornerHash> corner_ids;
+	std::vector<unsigned int> face;
+
+	positions.clear();
+	normals.clear();
+	uvs.clear();
+	triangles.clear();
+
+	while(!in.at_end())
+	{
+		Token cmd = in.next("obj command");
+		if(cmd == "v")
+		{
+			p.push_back(obj_float(in, cmd, "vertex position"));
+			p.push_back(obj_float(in, cmd, "vertex position"));
+			p.push_back(obj_float(in, cmd, "vertex position"));
+		}
+		else if(cmd == "vt")
+		{
+			Token tok;
+			t.push_back(obj_float(in, cmd, "texture coordinate"));
+			t.push_back(in.next_in_line(tok) ? in.parse_float(tok, "texture coordinate") : 0.0f);
+		}
+		else if(cmd == "vn")
+		{
+			n.push_back(obj_float(in, cmd, "vertex normal"));
+			n.push_back(obj_float(in, cmd, "vertex normal"));
+			n.push_back(obj_float(in, cmd, "vertex normal"));
+		}
+		else if(cmd == "f")
+		{
+			face.clear();
+			Token tok;
+			while(in.next_in_line(tok) && tok.ptr[0] != '#')
+			{
+				ObjCorner c = obj_corner(in, tok, p.size() / 3, t.size() / 2, n.size() / 3);
+				auto it = corner_ids.find(c);
+				if(it == corner_ids.end())
+				{
+					it = corner_ids.insert(std::make_pair(c, (unsigned int)corners.size())).first;
+					corners.push_back(c);
+				}
+				face.push_back(it->second);
+			}
+			if(face.size() < 3)
+				in.error(cmd, "face with less than three vertices");
+
+			for(size_t i = 2; i < face.size(); ++i)
+			{
+				triangles.push_back(face[0]);
+				triangles.push_back(face[i - 1]);
+				triangles.push_back(face[i]);
+			}
+		}
+		// comments, groups, materials, lines and points are not used
+		in.skip_line();
+	}
+
+	if(triangles.empty())
+		throw std::runtime_error(file + ": mesh without faces");
+
+	// one entry per distinct corner, attributes missing in some corners are
+	// left zeroed
+	bool has_uvs = false, has_normals = false;
+	for(size_t i = 0; i < corners.size(); ++i)
+	{
+		has_uvs |= corners[i].t >= 0;
+		has_normals |= corners[i].n >= 0;
+	}
+	positions.resize(3 * corners.size());
+	if(has_uvs)
+		uvs.assign(2 * corners.size(), 0.0f);
+	if(has_normals)
+		normals.assign(3 * corners.size(), 0.0f);
+	for(size_t i = 0; i < corners.size(); ++i)
+	{
+		const ObjCorner &c = corners[i];
+		for(int k = 0; k < 3; ++k)
+			positions[3 * i + k] = p[3 * c.p + k];
+		if(has_uvs && c.t >= 0)
+		{
+			uvs[2 * i] = t[2 * c.t];
+			uvs[2 * i + 1] = t[2 * c.t + 1];
+		}
+		if(has_normals && c.n >= 0)
+			for(int k = 0; k < 3; ++k)
+				normals[3 * i + k] = n[3 * c.n + k];
+	}
+	return true;
+}
+
+//////////////////////////////////////////////////////////
+/// Hierarchy and intersection
+//////////////////////////////////////////////////////////
+
+void TriangleMesh::build()
+{
+	size_t count = num_triangles();
+	std::vector<BBox> boxes(count);
+	for(size_t i = 0; i < count; ++i)
+		for(int k = 0; k < 3; ++k)
+		{
+			const float *v = &positions[3 * triangles[3 * i + k]];
+			boxes[i].expand(Point(v[0], v[1], v[2]));
+		}
+	// meshes do not move inside the object space
+	bvh.build(boxes, boxes, 0, 0);
+
+	// store the triangles in leaf order, so the leaves read them in sequence
+	std::vector<unsigned int> sorted(triangles.size());
+	for(size_t i = 0; i < count; ++i)
+	{
+		unsigned int tri = bvh.indices[i];
+		sorted[3 * i] = triangles[3 * tri];
+		sorted[3 * i + 1] = triangles[3 * tri + 1];
+		sorted[3 * i + 2] = triangles[3 * tri + 2];
+		bvh.indices[i] = i;
+	}
+	triangles.swap(sorted);
+}
+
+float TriangleMesh::hit_test(const Ray &ray, float tmax, Vector &normal, bool &back) const
+{
+	// watertight ray/triangle test (Woop, Benthin and Wald): vertices are
+	// moved to a space where the ray starts at the origin and points along
+	// +z, so neighbouring triangles share the exact same edge tests
+	const float org[3] = { ray.origin.x, ray.origin.y, ray.origin.z };
+	const float dir[3] = { ray.direction.x, ray.direction.y, ray.direction.z };
+	int kz = 0;
+	if(std::abs(dir[1]) > std::abs(dir[kz])) kz = 1;
+	if(std::abs(dir[2]) > std::abs(dir[kz])) kz = 2;
+	int kx = (kz + 1) % 3;
+	int ky = (kx + 1) % 3;
+	// keep the winding
+	if(dir[kz] < 0)
+		std::swap(kx, ky);
+	const float sx = dir[kx] / dir[kz];
+	const float sy = dir[ky] / dir[kz];
+	const float sz = 1.0f / dir[kz];
+
+	float closest_t = tmax;
+	unsigned int closest_tri = 0;
+	float bu = 0, bv = 0, bw = 0;
+	bool found = false;
+
+	bvh.traverse(ray, closest_t, [&](unsigned int tri) 
+	{
+		const unsigned int *idx = &triangles[3 * tri];
+		const float *a = &positions[3 * idx[0]];
+		const float *b = &positions[3 * idx[1]];
+		const float *c = &positions[3 * idx[2]];
+
+		const float az = a[kz] - org[kz];
+		const float bz = b[kz] - org[kz];
+		const float cz = c[kz] - org[kz];
+		const float ax = a[kx] - org[kx] - sx * az;
+		const float ay = a[ky] - org[ky] - sy * az;
+		const float bx = b[kx] - org[kx] - sx * bz;
+		const float by = b[ky] - org[ky] - sy * bz;
+		const float cx = c[kx] - org[kx] - sx * cz;
+		const float cy = c[ky] - org[ky] - sy * cz;
+
+		float u = cx * by - cy * bx;
+		float v = ax * cy - ay * cx;
+		float w = bx * ay - by * ax;
+		// edge cases are decided in double precision
+		if(u == 0.0f || v == 0.0f || w == 0.0f)
+		{
+			u = (float)((double)cx * by - (double)cy * bx);
+			v = (float)((double)ax * cy - (double)ay * cx);
+			w = (float)((double)bx * ay - (double)by * ax);
+		}
+		if((u < 0.0f || v < 0.0f || w < 0.0f) && (u > 0.0f || v > 0.0f || w > 0.0f))
+			return false;
+
+		float det = u + v + w;
+		if(det == 0.0f)
+			return false;
+		float t = (u * az + v * bz + w * cz) * sz / det;
+		if(t <= FLT_EPSILON || t >= closest_t)
+			return false;
+
+		closest_t = t;
+		closest_tri = tri;
+		bu = u / det;
+		bv = v / det;
+		bw = w / det;
+		found = true;
+		return false;
+	});
+
+	if(!found)
+		return -1.0f;
+
+	const unsigned int *idx = &triangles[3 * closest_tri];
+	const float *a = &positions[3 * idx[0]];
+	const float *b = &positions[3 * idx[1]];
+	const float *c = &positions[3 * idx[2]];
+	Vector e1(b[0] - a[0], b[1] - a[1], b[2] - a[2]);
+	Vector e2(c[0] - a[0], c[1] - a[1], c[2] - a[2]);
+	Vector geometric = Vector::cross(e1, e2);
+
+	normal = geometric;
+	if(!normals.empty())
+	{
+		const float *na = &normals[3 * idx[0]];
+		const float *nb = &normals[3 * idx[1]];
+		const float *nc = &normals[3 * idx[2]];
+		// the vertex normals tell the outer side, whatever the winding
+		Vector vertex_sum(na[0] + nb[0] + nc[0], na[1] + nb[1] + nc[1], na[2] + nb[2] + nc[2]);
+		if(Vector::dot(vertex_sum, geometric) < 0)
+			geometric = geometric * (-1);
+
+		Vector shading(	bu * na[0] + bv * nb[0] + bw * nc[0],
+						bu * na[1] + bv * nb[1] + bw * nc[1],
+						bu * na[2] + bv * nb[2] + bw * nc[2]);
+		// missing normals fall back to the triangle one
+		normal = Vector::dot(shading, geometric) > 0 ? shading : geometric;
+	}
+	back = Vector::dot(geometric, ray.direction) > 0;
+	normal.normalize();
+	return closest_t;
+}
@@ -0,0 +1,56 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#ifndef MESH_H
+#define MESH_H
+
+#include <vector>
+#include <string>
+#include "ray.h"
+#include "bvh.h"
+#include "math/bbox.h"
+
+// Indexed triangle mesh in object space. Vertex attributes are packed in
+// flat arrays, one entry per vertex, and shared by the triangles.
+class TriangleMesh
+{
+public:
+	// read a Wavefront OBJ file (positions, normals and uvs), polygons are
+	// split in triangle fans. Returns false if the file can not be opened
+	// and throws std::runtime_error, with file:line:column, if it is malformed.
+	bool load_obj(const std::string &file);
+	// build the hierarchy over the triangles, they are reordered to follow
+	// its leaves
+	void build();
+
+	// closest hit of the object space ray before tmax, -1 if none. normal
+	// is the shading normal on the outer side, back tells if the ray hits
+	// the back of the triangle.
+	float hit_test(const Ray &ray, float tmax, Vector &normal, bool &back) const;
+
+	inline size_t num_vertices() const { return positions.size() / 3; }
+	inline size_t num_triangles() const { return triangles.size() / 3; }
+	inline BBox bounds() const { return bvh.empty() ? BBox() : bvh.nodes[0].bounds0; }
+
+	std::string filename;
+	std::vector<float> positions;	// xyz per vertex
+	std::vector<float> normals;		// xyz per vertex, or empty
+	std::vector<float> uvs;			// uv per vertex, or empty
+	std::vector<unsigned int> triangles;	// three vertex indices per triangle
+	BVH bvh;
+};
+
+#endif
@@ -0,0 +1,128 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#include "mipmap.h"
+#include "timeline.h"
+#include <algorithm>
+#include <cmath>
+
+void MipMap::load(const std::string &file)
+{
+	// the full image is only needed until it is copied to the first level
+	PPMImage image;
+	image.load(file);
+	build(image);
+}
+
+void MipMap::build(const PPMImage &image)
+{
+	TIMELINE_SCOPE("build mipmaps");
+	pyramid.clear();
+	if(image.width == 0 || image.height == 0)
+		return;
+
+	// the texels are moved to their blocks once, here
+	Level base;
+	base.resize(image.width, image.height);
+	for(size_t h = 0; h < base.height; ++h)
+		for(size_t w = 0; w < base.width; ++w)
+			base.set_texel(w, h, image.data[h][w]);
+	pyramid.push_back(base);
+
+	while(pyramid.back().width > 1 || pyramid.back().height > 1)
+	{
+		const Level &src = pyramid.back();
+		Level level;
+		level.resize(std::max<size_t>(1, (src.width + 1) / 2), std::max<size_t>(1, (src.height + 1) / 2));
+		for(size_t y = 0; y < level.height; ++y)
+		{
+			// odd sizes take the first row or column again
+			size_t y0 = (2 * y) % src.height, y1 = (2 * y + 1) % src.height;
+			for(size_t x = 0; x < level.width; ++x)
+			{
+				size_t x0 = (2 * x) % src.width, x1 = (2 * x + 1) % src.width;
+				Color c = src.texel(x0, y0);
+				c += src.texel(x1, y0);
+				c += src.texel(x0, y1);
+				c += src.texel(x1, y1);
+				level.set_texel(x, y, c * 0.25f);
+			}
+		}
+		pyramid.push_back(level);
+	}
+}
+
+void MipMap::Level::resize(size_t w, size_t h)
+{
+	width = w;
+	height = h;
+	// the last blocks of a row or column are padded
+	blocks_x = (width + TEXEL_BLOCK - 1) / TEXEL_BLOCK;
+	size_t blocks_y = (height + TEXEL_BLOCK - 1) / TEXEL_BLOCK;
+	texels.assign(blocks_x * blocks_y * TEXEL_BLOCK * TEXEL_BLOCK, Color());
+}
+
+bool MipMap::parse_filter(const std::string &name, TextureFilter &filter)
+{
+	if(name == "nearest")
+		filter = NearestFilter;
+	else if(name == "trilinear")
+		filter = TrilinearFilter;
+	else
+		return false;
+	return true;
+}
+
+Color MipMap::nearest(double s, double r) const
+{
+	const Level &level = pyramid[0];
+	// floored, so the texels left of the origin are not folded onto texel 0
+	long long w = (long long)level.width, h = (long long)level.height;
+	long long u = (long long)std::floor(r * level.height) % h;
+	long long v = (long long)std::floor(s * level.width) % w;
+	if(u < 0) u += h;
+	if(v < 0) v += w;
+	return level.texel((size_t)v, (size_t)u);
+}
+
+Color MipMap::bilinear(const Level &level, double s, double r) const
+{
+	// texel centers are at half coordinates
+	double x = s * level.width - 0.5, y = r * level.height - 0.5;
+	double fx = std::floor(x), fy = std::floor(y);
+	float tx = (float)(x - fx), ty = (float)(y - fy);
+	long long w = (long long)level.width, h = (long long)level.height;
+	size_t x0 = (size_t)((((long long)fx % w) + w) % w), y0 = (size_t)((((long long)fy % h) + h) % h);
+	size_t x1 = x0 + 1 == level.width ? 0 : x0 + 1, y1 = y0 + 1 == level.height ? 0 : y0 + 1;
+	Color top = level.texel(x0, y0) * (1 - tx) + level.texel(x1, y0) * tx;
+	Color bottom = level.texel(x0, y1) * (1 - tx) + level.texel(x1, y1) * tx;
+	return top * (1 - ty) + bottom * ty;
+}
+
+Color MipMap::trilinear(double s, double r, float footprint) const
+{
+	// level where the footprint is about one texel wide
+	float lod = footprint > 1 ? std::log2(footprint) : 0;
+	float last = (float)(pyramid.size() - 1);
+	if(lod >= last)
+		return bilinear(pyramid.back(), s, r);
+	size_t l = (size_t)lod;
+	float t = lod - l;
+	Color c = bilinear(pyramid[l], s, r);
+	if(t > 0)
+		c = c * (1 - t) + bilinear(pyramid[l + 1], s, r) * t;
+	return c;
+}
@@ -0,0 +1,93 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#ifndef MIPMAP_H
+#define MIPMAP_H
+
+#include "color.h"
+#include "ppmimage.h"
+#include <string>
+#include <vector>
+
+// Side of the blocks of texels stored together. A 4x4 block of colors
+// takes three cache lines, a bilinear lookup mostly reads a single block
+// and the neighbouring texels of a shaded area a few blocks, instead of
+// a texel from rows far apart in memory. Building with
+// -DRAYTRACER_LINEAR_TEXTURES keeps the rows of the image, to compare.
+#ifdef RAYTRACER_LINEAR_TEXTURES
+#define TEXEL_BLOCK 1
+#else
+#define TEXEL_BLOCK 4
+#endif
+
+// How the texture maps are looked up
+enum TextureFilter
+{
+	NearestFilter,		// the texel under the point, in the full image
+	TrilinearFilter		// blends the two pyramid levels closest to the ray footprint
+};
+
+// Pyramid of a texture map, built once at load time. Every level halves
+// the one above with a 2x2 box filter, down to a single texel; the map
+// repeats, so the filter and the lookups wrap around the edges. A lookup
+// is given the width of the ray footprint in texels of the full image and
+// blends the bilinear lookups of the two levels around it, so far away or
+// grazing surfaces read a few texels of a small level instead of jumping
+// over the full one.
+class MipMap
+{
+public:
+	MipMap() {}
+
+	// reads a P6 file, throws std::runtime_error
+	void load(const std::string &file);
+	void build(const PPMImage &image);
+	// parses nearest or trilinear
+	static bool parse_filter(const std::string &name, TextureFilter &filter);
+
+	inline size_t levels() const { return pyramid.size(); }
+	inline size_t width() const { return pyramid.empty() ? 0 : pyramid[0].width; }
+	inline size_t height() const { return pyramid.empty() ? 0 : pyramid[0].height; }
+
+	// (s, r) are the texture coordinates, one repetition of the map for
+	// every unit, s along the width and r along the height
+	Color nearest(double s, double r) const;
+	Color trilinear(double s, double r, float footprint) const;
+
+private:
+	struct Level
+	{
+		size_t width;
+		size_t height;
+		size_t blocks_x;			// blocks in a row
+		std::vector<Color> texels;	// block by block, row by row inside them
+
+		void resize(size_t width, size_t height);
+		inline size_t index(size_t x, size_t y) const
+		{
+			return ((y / TEXEL_BLOCK) * blocks_x + x / TEXEL_BLOCK) * TEXEL_BLOCK * TEXEL_BLOCK 
+				+ (y % TEXEL_BLOCK) * TEXEL_BLOCK + x % TEXEL_BLOCK;
+		}
+		inline const Color &texel(size_t x, size_t y) const { return texels[index(x, y)]; }
+		inline void set_texel(size_t x, size_t y, const Color &c) { texels[index(x, y)] = c; }
+	};
+
+	Color bilinear(const Level &level, double s, double r) const;
+
+	std::vector<Level> pyramid;
+};
+
+#endif
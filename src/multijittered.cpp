@@ -1,4 +1,5 @@
 #include "multijittered.h"
+#include "timeline.h"
 
 #define RAND_FLOAT(a) (static_cast <float> (rand()) / static_cast <float> (RAND_MAX)) * a
 
@@ -48,6 +49,7 @@ MultiJittered::~MultiJittered(void) {}
 void
 MultiJittered::generate_samples(void) 
 {		
+	TIMELINE_SCOPE("generate samples");
 	// num_samples needs to be a perfect square	
 	int n = (int)sqrt((float)num_samples);
 	float subcell_width = 1.0 / ((float) num_samples);
@@ -18,6 +18,7 @@
 #include "scene.h"
 #include "math/math.h"
 #include "math/matrix.h"
+#include "math/precision.h"
 
 
 #define	IsZero(x)	((x) > -EQN_EPS && (x) < EQN_EPS)
@@ -25,9 +26,10 @@
 //////////////////////////////////////////////////////////
 /// Object class
 //////////////////////////////////////////////////////////
-Color Object::get_color(const Point &p)
+Color Object::get_color(const Point &p, const RayFootprint *footprint) const
 {
 	Color clr;
+	const Texture &texture = *this->texture;
 	switch(texture.type) 
 	{
         case SolidTexture:
@@ -42,7 +44,6 @@ Color Object::get_color(const Point &p)
 		break;
         case MapTexture:
 			double s, r;
-			int u, v;
             //texture interpolation
 			s =	texture.map.p0.x * p.x +
                 texture.map.p0.y * p.y +
@@ -52,16 +53,41 @@ Color Object::get_color(const Point &p)
                 texture.map.p1.y * p.y +
                 texture.map.p1.z * p.z +
                 texture.map.p1.w;
-            u = (int)(r * texture.map.image.height) % texture.map.image.height;
-            v = (int)(s * texture.map.image.width) % texture.map.image.width;
-            if(u < 0) u += texture.map.image.height;
-            if(v < 0) v += texture.map.image.width;
-            clr = texture.map.image.data.at(u).at(v);
+			if(footprint)
+				clr = texture.map.mip.trilinear(s, r, texel_footprint(texture.map, *footprint));
+			else
+				clr = texture.map.mip.nearest(s, r);
 		break;
     }
 	return clr;
 }
 
+float Object::texel_footprint(const MapTextureData &map, const RayFootprint &footprint)
+{
+	// texels of the full image per unit of distance along the planes
+	Vector ds = Vector(map.p0.x, map.p0.y, map.p0.z) * (float)map.mip.width();
+	Vector dr = Vector(map.p1.x, map.p1.y, map.p1.z) * (float)map.mip.height();
+
+	// the cone leaves an ellipse on the surface: as wide as the cone
+	// across the ray, stretched by the incidence along it
+	Vector d = footprint.direction;
+	d.normalize();
+	const Vector &n = footprint.normal;
+	float cos_d = Vector::dot(d, n);
+	Vector along = d - n * cos_d;
+	if(along.length() < 1e-6f)
+		along = std::fabs(n.x) < 0.9f ? Vector::cross(n, Vector(1, 0, 0)) : Vector::cross(n, Vector(0, 1, 0));
+	along.normalize();
+	Vector across = Vector::cross(n, along);
+	along = along * (footprint.width / std::max(std::fabs(cos_d), 1e-3f));
+	across = across * footprint.width;
+
+	float s0 = Vector::dot(ds, along), r0 = Vector::dot(dr, along);
+	float s1 = Vector::dot(ds, across), r1 = Vector::dot(dr, across);
+	// the longer axis, the lookup blurs rather than aliases
+	return std::sqrt(std::max(s0 * s0 + r0 * r0, s1 * s1 + r1 * r1));
+}
+
 Vector Object::mul_vec( Matrix4x4 &mat, const Vector &v)
 {
 	return Vector(	mat[0][0] * v.x + mat[0][1] * v.y + mat[0][2] * v.z,
@@ -76,6 +102,70 @@ Point Object::mul_point( Matrix4x4 &mat, const Point &p)
 					mat[2][0] * p.x + mat[2][1] * p.y + mat[2][2] * p.z + mat[2][3]);
 }
 
+Vector Object::mul_normal( Matrix4x4 &mat, const Vector &n)
+{
+	return Vector(	mat[0][0] * n.x + mat[1][0] * n.y + mat[2][0] * n.z,
+					mat[0][1] * n.x + mat[1][1] * n.y + mat[2][1] * n.z,
+					mat[0][2] * n.x + mat[1][2] * n.y + mat[2][2] * n.z);
+}
+
+void Object::calculate_transform(float dt)
+{
+	// acceleration at time dt
+	Vector c_acc = acceleration * dt;
+	// current pos
+	pos.x = original_pos.x + c_acc.x;
+	pos.y = original_pos.y + c_acc.y;
+	pos.z = original_pos.z + c_acc.z;
+
+	Point rot;
+	rot.x = toRads(original_rot.x);
+	rot.y = toRads(original_rot.y);
+	rot.z = toRads(original_rot.z);
+
+	//inverse translate matrix
+	Matrix4x4 i_t;
+	i_t.identity();
+	i_t[0][3] = -pos.x;	i_t[1][3] = -pos.y;	i_t[2][3] = -pos.z;
+
+	//inverse rotation matrix
+	Matrix4x4 i_rx, i_ry, i_rz;
+	i_rx.identity();
+	i_rx[1][1] = cos(rot.x);		i_rx[1][2] = sin(rot.x);
+	i_rx[2][1] = -sin(rot.x);		i_rx[2][2] = cos(rot.x);
+
+	i_ry.identity();	
+	i_ry[0][0] = cos(rot.y);		i_ry[0][2] = -sin(rot.y);
+	i_ry[2][0] = sin(rot.y);		i_ry[2][2] = cos(rot.y);
+
+	i_rz.identity();	
+	i_rz[0][0] = cos(rot.z);		i_rz[0][1] = sin(rot.z);
+	i_rz[1][0] = -sin(rot.z);		i_rz[1][1] = cos(rot.z);
+
+	//inverse scale matrix
+	Matrix4x4 i_s;
+	i_s.identity();
+	i_s[0][0] = 1/original_scale.x;	i_s[1][1] = 1/original_scale.y;	i_s[2][2] = 1/original_scale.z;
+
+	//object inverse transform matrix
+	inv_trans = i_s * i_ry * i_rx * i_rz * i_t;
+}
+
+BBox Object::transform_bounds(const BBox &local)
+{
+	// move every corner of the object space box to world space
+	Matrix4x4 trans = inv_trans.affine_inverse();
+	BBox world;
+	for(int i = 0; i < 8; ++i)
+	{
+		Point corner(	(i & 1) ? local.max.x : local.min.x,
+						(i & 2) ? local.max.y : local.min.y,
+						(i & 4) ? local.max.z : local.min.z);
+		world.expand(mul_point(trans, corner));
+	}
+	return world;
+}
+
 //////////////////////////////////////////////////////////
 /// Sphere class
 //////////////////////////////////////////////////////////
@@ -103,18 +193,35 @@ void SphereObject::calculate_matrices(float dt)
 	inv_trans = i_s;
 }
 
+BBox SphereObject::bounds()
+{
+	// the ray is scaled into object space, so the sphere is scaled back here
+	Point center(pos.x * original_scale.x, pos.y * original_scale.y, pos.z * original_scale.z);
+	Vector ext(	radius * std::abs(original_scale.x),
+				radius * std::abs(original_scale.y),
+				radius * std::abs(original_scale.z));
+	return BBox(center - ext, center + ext);
+}
+
 float SphereObject::hit_test(const Ray &ray, Vector &normal, const Point *max_pos, bool *inside)
+{
+	return hit<KernelPrecision::sphere>(ray, normal, max_pos, inside);
+}
+
+template<class T>
+float SphereObject::hit(const Ray &ray, Vector &normal, const Point *max_pos, bool *inside)
 {
 	Ray inv_ray;
 	inv_ray.origin = mul_point(inv_trans, ray.origin);
 	inv_ray.direction = mul_vec(inv_trans, ray.direction);
 	inv_ray.direction.normalize();
 
-	Vector e = (inv_ray.origin - pos);
-    double a = Vector::dot(inv_ray.direction, inv_ray.direction);
-    double b = 2.0f * Vector::dot(inv_ray.direction, e);
-    double c = Vector::dot(e, e) - std::pow(radius, 2);
-    double delta = std::pow(b, 2) - 4*a*c;
+	VectorT<T> dir(inv_ray.direction);
+	VectorT<T> e = PointT<T>(inv_ray.origin) - PointT<T>(pos);
+    T a = VectorT<T>::dot(dir, dir);
+    T b = 2 * VectorT<T>::dot(dir, e);
+    T c = VectorT<T>::dot(e, e) - T(radius) * T(radius);
+    T delta = b * b - 4 * a * c;
     
 	if(delta < FLT_EPSILON) 
         return -1.0f;
@@ -123,8 +230,8 @@ float SphereObject::hit_test(const Ray &ray, Vector &normal, const Point *max_po
     delta = std::sqrt(delta);
 
     // Test both solutions.
-    double t1 = (-b - delta) / (2.0f * a);
-    double t2 = (-b + delta) / (2.0f * a);
+    T t1 = (-b - delta) / (2 * a);
+    T t2 = (-b + delta) / (2 * a);
 
     // Calculate the maximum t.
     double max_t;
@@ -156,46 +263,162 @@ float SphereObject::hit_test(const Ray &ray, Vector &normal, const Point *max_po
         return -1.0f;
 }
 
+template float SphereObject::hit<float>(const Ray &ray, Vector &normal, const Point *max_pos, bool *inside);
+template float SphereObject::hit<double>(const Ray &ray, Vector &normal, const Point *max_pos, bool *inside);
+
 //////////////////////////////////////////////////////////
 /// Polyhedron class
 //////////////////////////////////////////////////////////
 
-PolyhedronObject::PolyhedronObject()
+PolyhedronObject::PolyhedronObject() : numFaces(0)
 {
 	type = Polyhedron;
+	original_scale = Point(1, 1, 1);
 }
 
-void PolyhedronObject::calculate_matrices(float dt)
-{}
-
-float PolyhedronObject::hit_test(const Ray &ray, Vector &normal, const Point *max_pos, bool *inside)
+// Point in double precision, the bounds come from many successive clips
+struct ClipPoint
 {
-    float t0 = 0.0f, t1 = FLT_MAX;
-    Vector n_t0, n_t1;
+	double x, y, z;
+};
+
+typedef std::vector<ClipPoint> ClipPolygon;
 
-	// run for every face
-    for(size_t i = 0; i < planes.size(); ++i) 
+// bounds of the region behind every plane, found clipping the faces of a
+// large box by each plane in turn
+static BBox clip_bounds(const std::vector<Plane> &planes)
+{
+	const double e = POLYHEDRON_MAX_EXTENT;
+	const ClipPoint box[8] = {	{-e, -e, -e}, {e, -e, -e}, {e, e, -e}, {-e, e, -e},
+								{-e, -e, e}, {e, -e, e}, {e, e, e}, {-e, e, e} };
+	const int box_faces[6][4] = { {0, 3, 2, 1}, {4, 5, 6, 7}, {0, 1, 5, 4}, {2, 3, 7, 6}, {0, 4, 7, 3}, {1, 2, 6, 5} };
+	std::vector<ClipPolygon> faces(6);
+	for(int i = 0; i < 6; ++i)
+		for(int j = 0; j < 4; ++j)
+			faces[i].push_back(box[box_faces[i][j]]);
+
+	for(size_t i = 0; i < planes.size() && !faces.empty(); ++i)
 	{
-        Vector p0(ray.origin.x, ray.origin.y, ray.origin.z);
-        Vector n = planes[i].normal();
-        float dn = Vector::dot(ray.direction, n); 
-        float vd = Vector::dot(p0, n) + planes[i].d; 
+		const Plane &pl = planes[i];
+		auto dist = [&](const ClipPoint &p) { return pl.a * p.x + pl.b * p.y + pl.c * p.z + pl.d; };
 
-        if((dn <= FLT_EPSILON && dn >= -FLT_EPSILON) && vd > FLT_EPSILON) 
+		// the points where the faces cross the plane make a new face
+		ClipPolygon cap;
+		std::vector<ClipPolygon> clipped;
+		for(size_t f = 0; f < faces.size(); ++f)
 		{
-			t1 = -1.0f;
-        }
-        else if(dn > FLT_EPSILON && t1 > -vd / dn) 
+			const ClipPolygon &face = faces[f];
+			ClipPolygon out;
+			for(size_t j = 0; j < face.size(); ++j)
+			{
+				const ClipPoint &p = face[j];
+				const ClipPoint &q = face[(j + 1) % face.size()];
+				double dp = dist(p), dq = dist(q);
+				if(dp <= 0)
+					out.push_back(p);
+				if(dp == 0)
+					cap.push_back(p);
+				if((dp < 0 && dq > 0) || (dp > 0 && dq < 0))
+				{
+					double s = dp / (dp - dq);
+					ClipPoint x = { p.x + s * (q.x - p.x), p.y + s * (q.y - p.y), p.z + s * (q.z - p.z) };
+					out.push_back(x);
+					cap.push_back(x);
+				}
+			}
+			if(out.size() >= 3)
+				clipped.push_back(out);
+		}
+
+		if(cap.size() >= 3)
 		{
-			 t1 = -vd / dn;
-             n_t1 = n;
-        }
-        else if(dn < -FLT_EPSILON && t0 < -vd / dn) 
+			// order the cap around its center, in a basis of the plane
+			ClipPoint c = { 0, 0, 0 };
+			for(size_t j = 0; j < cap.size(); ++j)
+			{
+				c.x += cap[j].x; c.y += cap[j].y; c.z += cap[j].z;
+			}
+			c.x /= cap.size(); c.y /= cap.size(); c.z /= cap.size();
+
+			Vector n(pl.a, pl.b, pl.c);
+			Vector u = std::abs(n.x) < 0.9f ? Vector::cross(n, Vector(1, 0, 0)) : Vector::cross(n, Vector(0, 1, 0));
+			Vector v = Vector::cross(n, u);
+			auto angle = [&](const ClipPoint &p)
+			{
+				double dx = p.x - c.x, dy = p.y - c.y, dz = p.z - c.z;
+				return atan2(dx * v.x + dy * v.y + dz * v.z, dx * u.x + dy * u.y + dz * u.z);
+			};
+			std::sort(cap.begin(), cap.end(), [&](const ClipPoint &p, const ClipPoint &q) { return angle(p) < angle(q); });
+			clipped.push_back(cap);
+		}
+		faces.swap(clipped);
+	}
+
+	BBox b;
+	for(size_t f = 0; f < faces.size(); ++f)
+		for(size_t j = 0; j < faces[f].size(); ++j)
 		{
-            t0 = -vd / dn;
-            n_t0 = n;    
-        }
-    }
+			const ClipPoint &p = faces[f][j];
+			if(std::max(std::abs(p.x), std::max(std::abs(p.y), std::abs(p.z))) >= 0.5 * e)
+				return BBox::infinite();
+			b.expand(Point((float)p.x, (float)p.y, (float)p.z));
+		}
+	if(b.empty())
+		return b;
+
+	// cover the rounding of the clipped points
+	Vector pad = (b.max - b.min) * 1e-4f + Vector(1e-4f, 1e-4f, 1e-4f);
+	return BBox(b.min - pad, b.max + pad);
+}
+
+void PolyhedronObject::build()
+{
+	// unit normals, the hit test gets the distance to each plane
+	for(size_t i = 0; i < planes.size(); ++i)
+	{
+		Plane &pl = planes[i];
+		float len = pl.normal().length();
+		if(len > 0)
+		{
+			pl.a /= len; pl.b /= len; pl.c /= len; pl.d /= len;
+		}
+	}
+	numFaces = planes.size();
+
+	size_t padded = (planes.size() + POLYHEDRON_BLOCK - 1) / POLYHEDRON_BLOCK * POLYHEDRON_BLOCK;
+	// a null normal with the origin inside: never entered, never left
+	plane_a.assign(padded, 0.0f);
+	plane_b.assign(padded, 0.0f);
+	plane_c.assign(padded, 0.0f);
+	plane_d.assign(padded, -1.0f);
+	for(size_t i = 0; i < planes.size(); ++i)
+	{
+		plane_a[i] = planes[i].a;
+		plane_b[i] = planes[i].b;
+		plane_c[i] = planes[i].c;
+		plane_d[i] = planes[i].d;
+	}
+
+	local_bounds = clip_bounds(planes);
+}
+
+void PolyhedronObject::calculate_matrices(float dt)
+{
+	calculate_transform(dt);
+}
+
+BBox PolyhedronObject::bounds()
+{
+	if(!local_bounds.bounded())
+		return local_bounds;
+	return transform_bounds(local_bounds);
+}
+
+float PolyhedronObject::hit_test(const Ray &ray, Vector &normal, const Point *max_pos, bool *inside)
+{
+	// the direction is not normalized, so t is the same in both spaces
+	Point ori = mul_point(inv_trans, ray.origin);
+	Vector dir = mul_vec(inv_trans, ray.direction);
 
     // Calculate the maximum t.
     double max_t;
@@ -204,21 +427,65 @@ float PolyhedronObject::hit_test(const Ray &ray, Vector &normal, const Point *ma
     else
         max_t = FLT_MAX;
 
-    if(t1 < t0)
+	if(local_bounds.bounded())
 	{
-		return -1.0f;
+		float tnear;
+		Vector inv_dir(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+		if(!local_bounds.hit(ori, inv_dir, max_t < FLT_MAX ? (float)max_t : FLT_MAX, tnear))
+			return -1.0f;
 	}
-    else if(std::abs(t0) <= FLT_EPSILON && (t1 >= t0) && t1 < max_t) 
+
+	// the ray enters the polyhedron at the last plane it crosses from the
+	// outside and leaves it at the first one it crosses from the inside
+    float t0 = 0.0f, t1 = FLT_MAX;
+	size_t i0 = 0, i1 = 0;
+	for(size_t b = 0; b < plane_a.size(); b += POLYHEDRON_BLOCK) 
 	{
-        normal = (n_t1 * (-1)).normalize();
-        return t1;
-    }
-    else if(t0 > FLT_EPSILON && t1 >= t0 && t0 < max_t) 
+		const float *pa = &plane_a[b], *pb = &plane_b[b], *pc = &plane_c[b], *pd = &plane_d[b];
+		float enter[POLYHEDRON_BLOCK], leave[POLYHEDRON_BLOCK];
+		int outside = 0;
+		for(int k = 0; k < POLYHEDRON_BLOCK; ++k)
+		{
+			float dn = dir.x * pa[k] + dir.y * pb[k] + dir.z * pc[k];
+			float vd = ori.x * pa[k] + ori.y * pb[k] + ori.z * pc[k] + pd[k];
+			float t = -vd / dn;
+			enter[k] = dn < -FLT_EPSILON ? t : -FLT_MAX;
+			leave[k] = dn > FLT_EPSILON ? t : FLT_MAX;
+			// parallel to a plane it is in front of
+			outside |= (dn <= FLT_EPSILON && dn >= -FLT_EPSILON && vd > FLT_EPSILON);
+		}
+		for(int k = 0; k < POLYHEDRON_BLOCK; ++k)
+		{
+			if(enter[k] > t0)
+			{
+				t0 = enter[k];
+				i0 = b + k;
+			}
+			if(leave[k] < t1)
+			{
+				t1 = leave[k];
+				i1 = b + k;
+			}
+		}
+		if(outside || t1 < t0)
+			return -1.0f;
+	}
+
+    if(std::abs(t0) <= FLT_EPSILON && t1 < max_t) 
+	{
+		normal = Vector(-plane_a[i1], -plane_b[i1], -plane_c[i1]);
+	}
+    else if(t0 > FLT_EPSILON && t0 < max_t) 
 	{
-        normal = n_t0.normalize();
-        return t0;
+		normal = Vector(plane_a[i0], plane_b[i0], plane_c[i0]);
+		t1 = t0;
     }
-    return -1.0f;
+	else
+		return -1.0f;
+
+	normal = mul_normal(inv_trans, normal);
+	normal.normalize();
+    return t1;
 }
 
 /////////////////////////////////////////
@@ -231,76 +498,52 @@ TorusObject::TorusObject()
 
 void TorusObject::calculate_matrices(float dt)
 {
-	// acceleration at time dt
-	Vector c_acc = acceleration * dt;
-	// current pos
-	pos.x = original_pos.x + c_acc.x;
-	pos.y = original_pos.y + c_acc.y;
-	pos.z = original_pos.z + c_acc.z;
-
-	Point rot;
-	rot.x = toRads(original_rot.x);
-	rot.y = toRads(original_rot.y);
-	rot.z = toRads(original_rot.z);
-
-	//inverse translate matrix
-	Matrix4x4 i_t;
-	i_t.identity();
-	i_t[0][3] = -pos.x;	i_t[1][3] = -pos.y;	i_t[2][3] = -pos.z;
-
-	//inverse rotation matrix
-	Matrix4x4 i_rx, i_ry, i_rz;
-	i_rx.identity();
-	i_rx[1][1] = cos(rot.x);		i_rx[1][2] = sin(rot.x);
-	i_rx[2][1] = -sin(rot.x);		i_rx[2][2] = cos(rot.x);
-
-	i_ry.identity();	
-	i_ry[0][0] = cos(rot.y);		i_ry[0][2] = -sin(rot.y);
-	i_ry[2][0] = sin(rot.y);		i_ry[2][2] = cos(rot.y);
-
-	i_rz.identity();	
-	i_rz[0][0] = cos(rot.z);		i_rz[0][1] = sin(rot.z);
-	i_rz[1][0] = -sin(rot.z);		i_rz[1][1] = cos(rot.z);
-
-	//inverse scale matrix
-	Matrix4x4 i_s;
-	i_s.identity();
-	i_s[0][0] = 1/original_scale.x;	i_s[1][1] = 1/original_scale.y;	i_s[2][2] = 1/original_scale.z;
+	calculate_transform(dt);
+}
 
-	//object inverse transform matrix
-	inv_trans = i_s * i_ry * i_rx * i_rz * i_t;
+BBox TorusObject::bounds()
+{
+	double r = radius + thickness;
+	return transform_bounds(BBox(Point(-r, -thickness, -r), Point(r, thickness, r)));
 }
 
 float TorusObject::hit_test(const Ray &ray, Vector &normal, const Point *max_pos, bool *inside)
+{
+	return hit<KernelPrecision::torus>(ray, normal, max_pos, inside);
+}
+
+template<class T>
+float TorusObject::hit(const Ray &ray, Vector &normal, const Point *max_pos, bool *inside)
 {
 	Ray inv_ray;
 	inv_ray.origin = mul_point(inv_trans, ray.origin);
 	inv_ray.direction = mul_vec(inv_trans, ray.direction);
 	inv_ray.direction.normalize();
 
-	double x1 = inv_ray.origin.x; double y1 = inv_ray.origin.y; double z1 = inv_ray.origin.z;
-	double d1 = inv_ray.direction.x; double d2 = inv_ray.direction.y; double d3 = inv_ray.direction.z;
+	T x1 = inv_ray.origin.x; T y1 = inv_ray.origin.y; T z1 = inv_ray.origin.z;
+	T d1 = inv_ray.direction.x; T d2 = inv_ray.direction.y; T d3 = inv_ray.direction.z;
+	T a = T(radius), r = T(thickness);
 
-	double coeffs[5];	// coefficient array
-	double roots[4];	// solution array
+	T coeffs[5];	// coefficient array
+	T roots[4];	// solution array
 
 	//define the coefficients
-	double sum_d_sqrd = d1*d1 + d2*d2 + d3*d3;
-	double e = x1*x1 + y1*y1 + z1*z1 - radius*radius - thickness*thickness;
-	double f = x1*d1 + y1*d2 + z1*d3;
-	double four_a_sqrd = 4.0 * radius*radius;
-
-	coeffs[0] = e*e - four_a_sqrd * (thickness*thickness-y1*y1);	// constante term
-	coeffs[1] = 4.0 * f * e + 2.0 * four_a_sqrd * y1 *d2;
-	coeffs[2] = 2.0 * sum_d_sqrd * e + 4.0 * f * f + four_a_sqrd * d2 * d2;
-	coeffs[3] = 4.0 * sum_d_sqrd * f;
+	T sum_d_sqrd = d1*d1 + d2*d2 + d3*d3;
+	T e = x1*x1 + y1*y1 + z1*z1 - a*a - r*r;
+	T f = x1*d1 + y1*d2 + z1*d3;
+	T four_a_sqrd = 4 * a*a;
+
+	coeffs[0] = e*e - four_a_sqrd * (r*r-y1*y1);	// constante term
+	coeffs[1] = 4 * f * e + 2 * four_a_sqrd * y1 *d2;
+	coeffs[2] = 2 * sum_d_sqrd * e + 4 * f * f + four_a_sqrd * d2 * d2;
+	coeffs[3] = 4 * sum_d_sqrd * f;
 	coeffs[4] = sum_d_sqrd * sum_d_sqrd;	// coefficient of t^4
 
 	//fin the roots
 	int num_real_roots = solveQuartic(coeffs, roots);
 
 	bool intersected = false;
-	double t = FLT_MAX;
+	T t = FLT_MAX;
 
 	if ( num_real_roots == 0)	// ray misses the torus
 		return -1.0;
@@ -333,6 +576,9 @@ float TorusObject::hit_test(const Ray &ray, Vector &normal, const Point *max_pos
 	return t;
 }
 
+template float TorusObject::hit<float>(const Ray &ray, Vector &normal, const Point *max_pos, bool *inside);
+template float TorusObject::hit<double>(const Ray &ray, Vector &normal, const Point *max_pos, bool *inside);
+
 Vector TorusObject::compute_normal(const Point& p) 
 {
 	Vector normal;
@@ -362,48 +608,21 @@ CylinderObject::CylinderObject()
 void CylinderObject::calculate_matrices(float dt)
 {
 	inv_radius = 1.0/radius;
-	
-	// acceleration at time dt
-	Vector c_acc = acceleration * dt;
-	// current pos
-	pos.x = original_pos.x + c_acc.x;
-	pos.y = original_pos.y + c_acc.y;
-	pos.z = original_pos.z + c_acc.z;
-
-	Point rot;
-	rot.x = toRads(original_rot.x);
-	rot.y = toRads(original_rot.y);
-	rot.z = toRads(original_rot.z);
-
-	//inverse translate matrix
-	Matrix4x4  i_t;
-	i_t.identity();
-	i_t[0][3] = -pos.x;	i_t[1][3] = -pos.y;	i_t[2][3] = -pos.z;
-
-	//inverse rotation matrix
-	Matrix4x4 i_rx, i_ry, i_rz;
-	i_rx.identity();
-	i_rx[1][1] = cos(rot.x);		i_rx[1][2] = sin(rot.x);
-	i_rx[2][1] = -sin(rot.x);		i_rx[2][2] = cos(rot.x);
-
-	i_ry.identity();	
-	i_ry[0][0] = cos(rot.y);		i_ry[0][2] = -sin(rot.y);
-	i_ry[2][0] = sin(rot.y);		i_ry[2][2] = cos(rot.y);
-
-	i_rz.identity();	
-	i_rz[0][0] = cos(rot.z);		i_rz[0][1] = sin(rot.z);
-	i_rz[1][0] = -sin(rot.z);		i_rz[1][1] = cos(rot.z);
-
-	//inverse scale matrix
-	Matrix4x4 i_s;
-	i_s.identity();
-	i_s[0][0] = 1/original_scale.x;	i_s[1][1] = 1/original_scale.y;	i_s[2][2] = 1/original_scale.z;
+	calculate_transform(dt);
+}
 
-	//object inverse transform matrix
-	inv_trans = i_s * i_ry * i_rx * i_rz * i_t;
+BBox CylinderObject::bounds()
+{
+	return transform_bounds(BBox(Point(-radius, bottom, -radius), Point(radius, top, radius)));
 }
 
 float CylinderObject::hit_test(const Ray &ray, Vector &normal, const Point *max_pos, bool *inside)
+{
+	return hit<KernelPrecision::cylinder, KernelPrecision::disk>(ray, normal, max_pos, inside);
+}
+
+template<class T, class D>
+float CylinderObject::hit(const Ray &ray, Vector &normal, const Point *max_pos, bool *inside)
 {
 	Ray inv_ray;
 	inv_ray.origin = mul_point(inv_trans, ray.origin);
@@ -415,7 +634,7 @@ float CylinderObject::hit_test(const Ray &ray, Vector &normal, const Point *max_
 	double t = FLT_MAX;
 
 	// check collision with cylinder body
-	double c_t = hit_cylinder(inv_ray, c_normal, c_inside);
+	double c_t = hit_cylinder<T>(inv_ray, c_normal, c_inside);
 	if(c_t > FLT_EPSILON && c_t < t) 
 	{
 		t = c_t;
@@ -425,23 +644,23 @@ float CylinderObject::hit_test(const Ray &ray, Vector &normal, const Point *max_
 	}
 
 	// check collision with bottom disk
-	c_t = hit_disk(inv_ray, c_normal, Vector(0, -1, 0), Point(0, bottom, 0));
+	c_t = hit_disk<D>(inv_ray, c_normal, Vector(0, -1, 0), Point(0, bottom, 0));
 	if(c_t > FLT_EPSILON && c_t < t) 
 	{
 		t = c_t;
 		normal = c_normal;	
 		if(inside)
-			inside = false;
+			*inside = false;
 	}
 
 	// check collision with top disk
-	c_t = hit_disk(inv_ray, c_normal, Vector(0, 1, 0), Point(0, top, 0));
+	c_t = hit_disk<D>(inv_ray, c_normal, Vector(0, 1, 0), Point(0, top, 0));
 	if(c_t > FLT_EPSILON && c_t < t) 
 	{
 		t = c_t;
 		normal = c_normal;
 		if(inside)
-			inside = false;
+			*inside = false;
 	}
 
 	double max_t;
@@ -460,16 +679,17 @@ float CylinderObject::hit_test(const Ray &ray, Vector &normal, const Point *max_
 		return -1.0;
 }
 
+template<class T>
 float CylinderObject::hit_cylinder(const Ray &ray, Vector &normal, bool &inside)
 {
-	double t;
-	double ox = ray.origin.x;	double oy = ray.origin.y;	double oz = ray.origin.z;
-	double dx = ray.direction.x;	double dy = ray.direction.y;	double dz = ray.direction.z;
+	T t;
+	T ox = ray.origin.x;	T oy = ray.origin.y;	T oz = ray.origin.z;
+	T dx = ray.direction.x;	T dy = ray.direction.y;	T dz = ray.direction.z;
 	
-	double a = dx * dx + dz * dz;  	
-	double b = 2.0 * (ox * dx + oz * dz);					
-	double c = ox * ox + oz * oz - radius * radius;
-	double disc = b * b - 4.0 * a * c ;
+	T a = dx * dx + dz * dz;  	
+	T b = 2 * (ox * dx + oz * dz);					
+	T c = ox * ox + oz * oz - T(radius) * T(radius);
+	T disc = b * b - 4 * a * c ;
 
 	Vector inv_rdir = ray.direction * (-1);
 
@@ -477,13 +697,13 @@ float CylinderObject::hit_cylinder(const Ray &ray, Vector &normal, bool &inside)
 		return -1.0;
 	else
 	{	
-		double e = sqrt(disc);
-		double denom = 2.0 * a;
+		T e = std::sqrt(disc);
+		T denom = 2 * a;
 		t = (-b - e) / denom;    // smaller root
 		
 		if (t > FLT_EPSILON)
 		{
-			double yhit = oy + t * dy;
+			T yhit = oy + t * dy;
 		
 			if (yhit > bottom && yhit < top) 
 			{
@@ -502,10 +722,10 @@ float CylinderObject::hit_cylinder(const Ray &ray, Vector &normal, bool &inside)
 		t = (-b + e) / denom;    // larger root
 		if (t > FLT_EPSILON)
 		{
-			double yhit = oy + t * dy;
+			T yhit = oy + t * dy;
 
-			double xhit = ox + t * dx;
-			double zhit = oz + t * dz;
+			T xhit = ox + t * dx;
+			T zhit = oz + t * dz;
 
 			if (yhit > bottom && yhit < top) 
 			{
@@ -524,19 +744,20 @@ float CylinderObject::hit_cylinder(const Ray &ray, Vector &normal, bool &inside)
 	return -1.0;
 }
 
+template<class T>
 float CylinderObject::hit_disk(const Ray &ray, Vector &normal, Vector disk_normal, Point disk_pos)
 {
-	double r_squared = radius * radius;
+	T r_squared = T(radius) * T(radius);
 
-	double t = Vector::dot((disk_pos - ray.origin), disk_normal) / Vector::dot(ray.direction, disk_normal);
+	VectorT<T> n(disk_normal), dir(ray.direction);
+	PointT<T> origin(ray.origin), center(disk_pos);
+	T t = VectorT<T>::dot(center - origin, n) / VectorT<T>::dot(dir, n);
 		
 	if (t <= FLT_EPSILON)
 		return -1.0;
 		
-	Point p = ray.origin + t * ray.direction;
-	double d_squared =  pow(disk_pos.x - p.x, 2) +
-						pow(disk_pos.y - p.y, 2) +
-						pow(disk_pos.z - p.z, 2);
+	VectorT<T> d = center - (origin + t * dir);
+	T d_squared = VectorT<T>::dot(d, d);
 		
 	if (d_squared < r_squared) 
 	{
@@ -546,4 +767,48 @@ float CylinderObject::hit_disk(const Ray &ray, Vector &normal, Vector disk_norma
 	return -1.0;
 }
 
+template float CylinderObject::hit<float, float>(const Ray &ray, Vector &normal, const Point *max_pos, bool *inside);
+template float CylinderObject::hit<double, double>(const Ray &ray, Vector &normal, const Point *max_pos, bool *inside);
+
+
 
+/////////////////////////////////////////////////////////
+/// Mesh
+/////////////////////////////////////////////////////////
+MeshObject::MeshObject()
+{
+	type = Mesh;
+}
+
+void MeshObject::calculate_matrices(float dt)
+{
+	calculate_transform(dt);
+}
+
+BBox MeshObject::bounds()
+{
+	return transform_bounds(mesh->bounds());
+}
+
+float MeshObject::hit_test(const Ray &ray, Vector &normal, const Point *max_pos, bool *inside)
+{
+	// the direction is not normalized, so t is the same in both spaces
+	Ray inv_ray(mul_point(inv_trans, ray.origin), mul_vec(inv_trans, ray.direction), ray.time, ray.sample);
+
+	double max_t;
+	if(max_pos)
+		max_t = (max_pos->x - ray.origin.x) / ray.direction.x;
+	else
+		max_t = FLT_MAX;
+
+	bool back;
+	float t = mesh->hit_test(inv_ray, max_t < FLT_MAX ? (float)max_t : FLT_MAX, normal, back);
+	if(t < 0)
+		return -1.0f;
+
+	if(inside)
+		*inside = back;
+	normal = mul_normal(inv_trans, normal);
+	normal.normalize();
+	return t;
+}
@@ -21,6 +21,9 @@
 #include "ray.h"
 #include "math/plane.h"
 #include "math/matrix.h"
+#include "math/bbox.h"
+#include "mesh.h"
+#include <memory>
 
 // Types of objects.
 enum ObjectType 
@@ -28,24 +31,40 @@ enum ObjectType
     Sphere,
     Polyhedron,
 	Torus,
-	Cylinder
+	Cylinder,
+	Mesh,
+	Instance
 };
 
 // Base Object.
 class Object 
 {
 public:
-	Object(){}
+	Object() : texture(NULL) {}
+	virtual ~Object() {}
 
 	virtual void calculate_matrices(float dt = 0) {}
 	virtual float hit_test(const Ray &ray, Vector &normal, const Point *endPos = NULL, bool *inside = NULL){return -1.0;}
+	// world bounds at the time given to the last calculate_matrices call
+	virtual BBox bounds() { return BBox::infinite(); }
 	Vector mul_vec( Matrix4x4 &mat, const Vector &p);
 	Point mul_point( Matrix4x4 &mat, const Point &p);
-    Color get_color(const Point &p);
+	// multiply by the transposed matrix, moves normals back to world space
+	Vector mul_normal( Matrix4x4 &mat, const Vector &n);
+	// texture color at p. Map textures take the texel under p, or a
+	// filtered lookup sized by the footprint when there is one.
+    Color get_color(const Point &p, const RayFootprint *footprint = NULL) const;
+	BBox transform_bounds(const BBox &local);
+	// width of a footprint in texels of the full image of a map
+	static float texel_footprint(const MapTextureData &map, const RayFootprint &footprint);
+	// true if the object does not move while the shutter is open
+	inline bool is_static() const { return acceleration == Vector(); }
+	// true if parts of the object can hide or reflect other parts of it
+	inline bool self_occluding() const { return type == Mesh || type == Instance; }
 	
 	size_t id;
     ObjectType type;
-	Texture texture;
+	const Texture *texture;	// owned by the scene
 	Material material;
 	
 	Vector acceleration;
@@ -55,6 +74,10 @@ public:
 	Point original_rot;
     Point original_scale;
 	Matrix4x4 inv_trans;
+
+protected:
+	// inv_trans from the position at time dt, rotation and scale
+	void calculate_transform(float dt);
 };
 
 
@@ -66,24 +89,48 @@ public:
 
 	void calculate_matrices(float dt = 0) override;
 
+	BBox bounds() override;
+
 	float hit_test(const Ray &ray, Vector &normal, const Point *max_pos = NULL, bool *inside = NULL) override;    
+	// hit test solved in the scalar type T, float or double. hit_test uses
+	// the one of the build's precision policy, see math/precision.h
+	template<class T>
+	float hit(const Ray &ray, Vector &normal, const Point *max_pos = NULL, bool *inside = NULL);
 	// sphere radius.
     float radius;
 };
 
-// Polyhedron object.
+// planes clipped together by the polyhedron hit test
+#define POLYHEDRON_BLOCK 8
+// half size of the box clipped by the planes to find the bounds, the
+// polyhedra reaching its sides are unbounded
+#define POLYHEDRON_MAX_EXTENT 1e6
+
+// Polyhedron object, the convex region behind all of its planes.
 class PolyhedronObject : public Object
 {
 public:
 	PolyhedronObject();
 
+	// normalizes the planes and finds the bounds, called once they are read
+	void build();
+
 	void calculate_matrices(float dt = 0) override;
 
+	BBox bounds() override;
+
 	float hit_test(const Ray &ray, Vector &normal, const Point *max_pos = NULL, bool *inside = NULL) override;
     // number of faces.
     size_t numFaces;
     // faces
     std::vector<Plane> planes;
+
+private:
+	// plane coefficients, one array each, padded to whole blocks with
+	// planes no ray can cross
+	std::vector<float> plane_a, plane_b, plane_c, plane_d;
+	// object space bounds
+	BBox local_bounds;
 };
 
 class TorusObject : public Object
@@ -93,7 +140,12 @@ public:
 
 	void calculate_matrices(float dt = 0) override;
 
+	BBox bounds() override;
+
 	float hit_test(const Ray &ray, Vector &normal, const Point *max_pos = NULL, bool *inside = NULL) override;
+	// hit test solved in the scalar type T, as the sphere's
+	template<class T>
+	float hit(const Ray &ray, Vector &normal, const Point *max_pos = NULL, bool *inside = NULL);
 	// torus radius
 	double radius;
 	// torus thickness
@@ -110,7 +162,12 @@ public:
 
 	void calculate_matrices(float dt = 0) override;
 
+	BBox bounds() override;
+
 	float hit_test(const Ray &ray, Vector &normal, const Point *max_pos = NULL, bool *inside = NULL) override;
+	// hit test solved in the scalar type T for the body and D for the caps
+	template<class T, class D = T>
+	float hit(const Ray &ray, Vector &normal, const Point *max_pos = NULL, bool *inside = NULL);
 
 	double bottom;
 	double top;
@@ -121,9 +178,27 @@ private:
 	Point up_pos;
 	double inv_radius;
 
+	template<class T>
 	float hit_cylinder(const Ray &ray, Vector &normal, bool &inside);
+	template<class T>
 	float hit_disk(const Ray &ray, Vector &normal, Vector disk_normal, Point disk_pos);
 
 };
 
+// Triangle mesh placed by the object transform, the mesh and its
+// hierarchy stay in object space so it moves without being rebuilt.
+class MeshObject : public Object
+{
+public:
+	MeshObject();
+
+	void calculate_matrices(float dt = 0) override;
+
+	BBox bounds() override;
+
+	float hit_test(const Ray &ray, Vector &normal, const Point *max_pos = NULL, bool *inside = NULL) override;
+
+	std::shared_ptr<TriangleMesh> mesh;
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,163 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#include "pixelorder.h"
+#include <algorithm>
+#include <utility>
+
+PixelTraversal::PixelTraversal(PixelOrder pixel_order, size_t w, size_t h)
+	: order(pixel_order), width(w), height(h), tiles_x(0)
+{
+	if(order == ScanlineOrder)
+		return;
+	tiles_x = (width + PIXEL_TILE_SIZE - 1) / PIXEL_TILE_SIZE;
+	size_t tiles_y = (height + PIXEL_TILE_SIZE - 1) / PIXEL_TILE_SIZE;
+	uint32_t side = 1;
+	while(side < std::max(tiles_x, tiles_y))
+		side *= 2;
+	// sorts the tiles of the image by their place on the curve, rather
+	// than walking the whole square, mostly empty for wide bands
+	std::vector<std::pair<uint32_t, uint32_t> > keyed;
+	keyed.reserve(tiles_x * tiles_y);
+	for(size_t ty = 0; ty < tiles_y; ++ty)
+		for(size_t tx = 0; tx < tiles_x; ++tx)
+			keyed.push_back(std::make_pair(curve_index(order, (uint32_t)tx, (uint32_t)ty, side), (uint32_t)(ty * tiles_x + tx)));
+	std::sort(keyed.begin(), keyed.end());
+	tiles.reserve(keyed.size());
+	for(size_t i = 0; i < keyed.size(); ++i)
+		tiles.push_back(keyed[i].second);
+	for(uint32_t i = 0; i < PIXEL_TILE_SIZE * PIXEL_TILE_SIZE; ++i)
+	{
+		uint32_t x, y;
+		curve_cell(order, i, PIXEL_TILE_SIZE, x, y);
+		tile_x[i] = (uint8_t)x;
+		tile_y[i] = (uint8_t)y;
+	}
+}
+
+// even bits of v, packed
+static uint32_t compact_bits(uint32_t v)
+{
+	v &= 0x55555555;
+	v = (v | (v >> 1)) & 0x33333333;
+	v = (v | (v >> 2)) & 0x0f0f0f0f;
+	v = (v | (v >> 4)) & 0x00ff00ff;
+	v = (v | (v >> 8)) & 0x0000ffff;
+	return v;
+}
+
+void PixelTraversal::curve_cell(PixelOrder order, uint32_t index, uint32_t side, uint32_t &x, uint32_t &y)
+{
+	if(order == MortonOrder)
+	{
+		// the bits of x and y interleaved
+		x = compact_bits(index);
+		y = compact_bits(index >> 1);
+		return;
+	}
+	if(order == HilbertOrder)
+	{
+		// quadrant by quadrant from the finest level, rotating the
+		// sub-curve so its ends meet the neighbour quadrants
+		x = y = 0;
+		for(uint32_t s = 1; s < side; s *= 2)
+		{
+			uint32_t rx = 1 & (index / 2);
+			uint32_t ry = 1 & (index ^ rx);
+			if(ry == 0)
+			{
+				if(rx == 1)
+				{
+					x = s - 1 - x;
+					y = s - 1 - y;
+				}
+				std::swap(x, y);
+			}
+			x += s * rx;
+			y += s * ry;
+			index /= 4;
+		}
+		return;
+	}
+	x = index % side;
+	y = index / side;
+}
+
+// v with a zero bit after every bit, the inverse of compact_bits
+static uint32_t spread_bits(uint32_t v)
+{
+	v &= 0x0000ffff;
+	v = (v | (v << 8)) & 0x00ff00ff;
+	v = (v | (v << 4)) & 0x0f0f0f0f;
+	v = (v | (v << 2)) & 0x33333333;
+	v = (v | (v << 1)) & 0x55555555;
+	return v;
+}
+
+uint32_t PixelTraversal::curve_index(PixelOrder order, uint32_t x, uint32_t y, uint32_t side)
+{
+	if(order == MortonOrder)
+		return spread_bits(x) | (spread_bits(y) << 1);
+	if(order == HilbertOrder)
+	{
+		// quadrant by quadrant from the coarsest level, undoing the
+		// rotations of curve_cell
+		uint32_t index = 0;
+		for(uint32_t s = side / 2; s > 0; s /= 2)
+		{
+			uint32_t rx = (x & s) ? 1 : 0;
+			uint32_t ry = (y & s) ? 1 : 0;
+			index += s * s * ((3 * rx) ^ ry);
+			if(ry == 0)
+			{
+				if(rx == 1)
+				{
+					x = side - 1 - x;
+					y = side - 1 - y;
+				}
+				std::swap(x, y);
+			}
+		}
+		return index;
+	}
+	return y * side + x;
+}
+
+bool PixelTraversal::parse(const std::string &name, PixelOrder &order)
+{
+	if(name == "scanline")
+		order = ScanlineOrder;
+	else if(name == "morton")
+		order = MortonOrder;
+	else if(name == "hilbert")
+		order = HilbertOrder;
+	else
+		return false;
+	return true;
+}
+
+const char *PixelTraversal::name(PixelOrder order)
+{
+	switch(order)
+	{
+	case MortonOrder:
+		return "morton";
+	case HilbertOrder:
+		return "hilbert";
+	default:
+		return "scanline";
+	}
+}
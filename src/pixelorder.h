@@ -0,0 +1,91 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#ifndef PIXELORDER_H
+#define PIXELORDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// side of the square tiles of the curve orders, a power of two
+#define PIXEL_TILE_SIZE 16
+
+// order in which the pixels of an image are rendered
+enum PixelOrder
+{
+	ScanlineOrder,
+	MortonOrder,
+	HilbertOrder
+};
+
+// Walks an image in the chosen order. Scanline renders one row after the
+// other. The curve orders walk the tiles of the frame along the curve and
+// the pixels of every tile along it too, so successive rays stay close
+// together in the scene data and the texture maps.
+class PixelTraversal
+{
+public:
+	PixelTraversal(PixelOrder order, size_t width, size_t height);
+
+	// rows, or tiles for the curve orders. The curve covers a square of
+	// tiles, only those holding pixels of the image are walked.
+	inline size_t num_tiles() const { return order == ScanlineOrder ? height : tiles.size(); }
+
+	// calls pixel(w, h) for every pixel of a row or tile, in order
+	template<class F>
+	void for_each_pixel(size_t tile, F pixel) const
+	{
+		if(order == ScanlineOrder)
+		{
+			for(size_t w = 0; w < width; ++w)
+				pixel(w, tile);
+			return;
+		}
+		size_t x0 = (tiles[tile] % tiles_x) * PIXEL_TILE_SIZE;
+		size_t y0 = (tiles[tile] / tiles_x) * PIXEL_TILE_SIZE;
+		for(int i = 0; i < PIXEL_TILE_SIZE * PIXEL_TILE_SIZE; ++i)
+		{
+			size_t w = x0 + tile_x[i], h = y0 + tile_y[i];
+			if(w < width && h < height)
+				pixel(w, h);
+		}
+	}
+
+	// position of the index-th cell along the curve over a side x side
+	// grid, side a power of two
+	static void curve_cell(PixelOrder order, uint32_t index, uint32_t side, uint32_t &x, uint32_t &y);
+	// the inverse, index along the curve of the cell (x, y)
+	static uint32_t curve_index(PixelOrder order, uint32_t x, uint32_t y, uint32_t side);
+
+	// "scanline", "morton" or "hilbert"
+	static bool parse(const std::string &name, PixelOrder &order);
+	static const char *name(PixelOrder order);
+
+private:
+	PixelOrder order;
+	size_t width;
+	size_t height;
+	size_t tiles_x;
+	// the tiles holding pixels (y * tiles_x + x), in curve order
+	std::vector<uint32_t> tiles;
+	// the curve inside a tile, computed once
+	uint8_t tile_x[PIXEL_TILE_SIZE * PIXEL_TILE_SIZE];
+	uint8_t tile_y[PIXEL_TILE_SIZE * PIXEL_TILE_SIZE];
+};
+
+#endif
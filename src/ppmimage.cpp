@@ -15,6 +15,7 @@
 * Universidade Federal de Minas Gerais (UFMG) 
 */
 #include "ppmimage.h"
+#include "timeline.h"
 #include <algorithm>
 #include <fstream>
 #include <sstream>
@@ -36,6 +37,7 @@ void PPMImage::set_color(const int &w, const int &h, Color c)
 
 bool PPMImage::save(const std::string filename)
 {
+	TIMELINE_SCOPE("save image");
 	// Create image PPM file.
     std::ofstream file(filename);
     if(!file.is_open()) 
@@ -58,6 +60,7 @@ bool PPMImage::save(const std::string filename)
 
 void PPMImage::load(const std::string &file) 
 {
+	TIMELINE_SCOPE("load texture");
     std::ifstream in(file.c_str());
     if(!in)
         throw std::runtime_error("Failed to open ppm file");
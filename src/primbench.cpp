@@ -0,0 +1,502 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#include "primbench.h"
+#include "object.h"
+#include "arena.h"
+#include "math/math.h"
+#include "math/precision.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// share of rays aimed at the object in each batch
+static const double hit_ratios[] = { 0.0, 0.5, 1.0 };
+
+// Point in double precision, for the reference
+struct RefPoint
+{
+	double x, y, z;
+};
+
+static inline RefPoint ref_point(double x, double y, double z) { RefPoint p = { x, y, z }; return p; }
+static inline double ref_dot(const RefPoint &a, const RefPoint &b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+static inline RefPoint ref_add(const RefPoint &a, const RefPoint &b, double s) { return ref_point(a.x + s * b.x, a.y + s * b.y, a.z + s * b.z); }
+static inline RefPoint ref_normalize(const RefPoint &a) { double l = sqrt(ref_dot(a, a)); return ref_point(a.x / l, a.y / l, a.z / l); }
+
+typedef std::mt19937 Rng;
+
+// the measured distances end here, so the calls are not optimized away
+static volatile double distance_sink;
+
+static double uniform(Rng &rng, double a, double b)
+{
+	return a + (b - a) * (rng() / 4294967296.0);
+}
+
+static RefPoint random_direction(Rng &rng)
+{
+	double z = uniform(rng, -1, 1);
+	double phi = uniform(rng, 0, 2 * M_PI);
+	double r = sqrt(1 - z * z);
+	return ref_point(r * cos(phi), r * sin(phi), z);
+}
+
+// a hit test of the object, called through a pointer so the kernels
+// compiled in each scalar type are measured with the same call overhead
+typedef float (*Kernel)(Object *object, const Ray &ray, Vector &normal, bool *inside);
+
+static float build_kernel(Object *object, const Ray &ray, Vector &normal, bool *inside)
+{
+	return object->hit_test(ray, normal, NULL, inside);
+}
+
+template<class O, class T>
+static float scalar_kernel(Object *object, const Ray &ray, Vector &normal, bool *inside)
+{
+	return static_cast<O*>(object)->template hit<T>(ray, normal, NULL, inside);
+}
+
+// One object under test, centered at the origin. The signed distance
+// is negative inside and never larger than the true distance, so the
+// reference can march with it.
+struct PrimitiveCase
+{
+	std::string name;
+	Object *object;
+	// kernel measured and the scalar type it solves in
+	Kernel kernel;
+	std::string precision;
+	// the kernel in each scalar type, NULL for the float only primitives
+	Kernel float_kernel, double_kernel;
+	double radius;		// bounding sphere
+	std::function<double(const RefPoint&)> distance;
+	// point the hit rays aim at, a ray reaching it from outside hits the
+	// part of the object being measured first
+	std::function<RefPoint(Rng&)> target;
+	// direction from the center to the ray origins
+	std::function<RefPoint(Rng&)> origin;
+};
+
+struct RayBatch
+{
+	std::vector<Ray> rays;
+	std::vector<RefPoint> ref_origins, ref_dirs;
+};
+
+static RayBatch make_rays(const PrimitiveCase &c, size_t count, double ratio, Rng &rng)
+{
+	RayBatch batch;
+	double dist = 3 * c.radius;
+	for(size_t i = 0; i < count; ++i)
+	{
+		RefPoint o = c.origin(rng);
+		RefPoint ori = ref_point(o.x * dist, o.y * dist, o.z * dist);
+		RefPoint dir;
+		if(uniform(rng, 0, 1) < ratio)
+		{
+			RefPoint t = c.target(rng);
+			dir = ref_normalize(ref_point(t.x - ori.x, t.y - ori.y, t.z - ori.z));
+		}
+		else
+		{
+			// away from the center by more than the bounding sphere seen
+			// from the origin, so the ray misses it
+			RefPoint side;
+			do
+			{
+				RefPoint r = random_direction(rng);
+				side = ref_add(r, o, -ref_dot(r, o));
+			} while(ref_dot(side, side) < 1e-6);
+			side = ref_normalize(side);
+			double s = uniform(rng, 1.05, 2.0) * c.radius / dist;
+			dir = ref_add(ref_point(-o.x * sqrt(1 - s * s), -o.y * sqrt(1 - s * s), -o.z * sqrt(1 - s * s)), side, s);
+		}
+		Ray ray(Point((float)ori.x, (float)ori.y, (float)ori.z), Vector((float)dir.x, (float)dir.y, (float)dir.z));
+		batch.rays.push_back(ray);
+		// the reference starts from the same float ray
+		batch.ref_origins.push_back(ref_point(ray.origin.x, ray.origin.y, ray.origin.z));
+		batch.ref_dirs.push_back(ref_normalize(ref_point(ray.direction.x, ray.direction.y, ray.direction.z)));
+	}
+	return batch;
+}
+
+// first crossing of the surface, marching by the signed distance and
+// refined by bisection. -1 if the ray misses
+static double reference_hit(const PrimitiveCase &c, const RefPoint &ori, const RefPoint &dir)
+{
+	// part of the ray inside the bounding sphere
+	double b = ref_dot(ori, dir);
+	double disc = b * b - (ref_dot(ori, ori) - 1.02 * c.radius * c.radius);
+	if(disc < 0)
+		return -1;
+	double t = std::max(0.0, -b - sqrt(disc)), t_end = -b + sqrt(disc);
+
+	double prev = t;
+	for(int i = 0; i < 1000000 && t < t_end; ++i)
+	{
+		double d = c.distance(ref_add(ori, dir, t));
+		if(d < 0)
+		{
+			// the surface is between the last two steps
+			double lo = prev, hi = t;
+			for(int j = 0; j < 100 && hi - lo > 1e-14; ++j)
+			{
+				double mid = 0.5 * (lo + hi);
+				if(c.distance(ref_add(ori, dir, mid)) < 0)
+					hi = mid;
+				else
+					lo = mid;
+			}
+			return 0.5 * (lo + hi);
+		}
+		prev = t;
+		t += std::max(d, 1e-7);
+	}
+	return -1;
+}
+
+static double now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static std::vector<PrimitiveCase> make_cases(Arena &arena)
+{
+	std::vector<PrimitiveCase> cases;
+	auto any_side = [](Rng &rng) { return random_direction(rng); };
+
+	{
+		SphereObject *sphere = arena.create<SphereObject>();
+		sphere->radius = 1;
+		sphere->original_scale = Point(1, 1, 1);
+		PrimitiveCase c;
+		c.name = "sphere";
+		c.object = sphere;
+		c.precision = scalar_name<KernelPrecision::sphere>();
+		c.float_kernel = scalar_kernel<SphereObject, float>;
+		c.double_kernel = scalar_kernel<SphereObject, double>;
+		c.radius = 1;
+		c.distance = [](const RefPoint &p) { return sqrt(ref_dot(p, p)) - 1; };
+		c.target = [](Rng &rng) { RefPoint d = random_direction(rng); double r = 0.99 * cbrt(uniform(rng, 0, 1)); return ref_point(d.x * r, d.y * r, d.z * r); };
+		c.origin = any_side;
+		cases.push_back(c);
+	}
+	{
+		// ring around the y axis
+		TorusObject *torus = arena.create<TorusObject>();
+		torus->radius = 1;
+		torus->thickness = 0.25;
+		torus->original_scale = Point(1, 1, 1);
+		PrimitiveCase c;
+		c.name = "torus";
+		c.object = torus;
+		c.precision = scalar_name<KernelPrecision::torus>();
+		c.float_kernel = scalar_kernel<TorusObject, float>;
+		c.double_kernel = scalar_kernel<TorusObject, double>;
+		c.radius = 1.25;
+		c.distance = [](const RefPoint &p) { double q = sqrt(p.x * p.x + p.z * p.z) - 1; return sqrt(q * q + p.y * p.y) - 0.25; };
+		c.target = [](Rng &rng) 
+		{
+			double u = uniform(rng, 0, 2 * M_PI), v = uniform(rng, 0, 2 * M_PI), r = 0.24 * sqrt(uniform(rng, 0, 1));
+			return ref_point((1 + r * cos(v)) * cos(u), r * sin(v), (1 + r * cos(v)) * sin(u));
+		};
+		c.origin = any_side;
+		cases.push_back(c);
+	}
+	// cylinder along the y axis, from -1 to 1
+	auto cylinder_distance = [](const RefPoint &p) { return std::max(sqrt(p.x * p.x + p.z * p.z) - 0.5, std::abs(p.y) - 1); };
+	{
+		CylinderObject *cylinder = arena.create<CylinderObject>();
+		cylinder->bottom = -1;
+		cylinder->top = 1;
+		cylinder->radius = 0.5;
+		cylinder->original_scale = Point(1, 1, 1);
+		PrimitiveCase c;
+		c.name = "cylinder body";
+		c.object = cylinder;
+		c.precision = scalar_name<KernelPrecision::cylinder>();
+		c.float_kernel = scalar_kernel<CylinderObject, float>;
+		c.double_kernel = scalar_kernel<CylinderObject, double>;
+		c.radius = sqrt(1.25);
+		c.distance = cylinder_distance;
+		// the side, seen from around it
+		c.target = [](Rng &rng) { double u = uniform(rng, 0, 2 * M_PI); return ref_point(0.5 * cos(u), uniform(rng, -0.6, 0.6), 0.5 * sin(u)); };
+		c.origin = [](Rng &rng) { double u = uniform(rng, 0, 2 * M_PI); return ref_point(cos(u), 0, sin(u)); };
+		cases.push_back(c);
+
+		c.name = "cylinder disks";
+		c.precision = scalar_name<KernelPrecision::disk>();
+		// the caps, seen from above and below
+		c.target = [](Rng &rng) 
+		{
+			double u = uniform(rng, 0, 2 * M_PI), r = 0.49 * sqrt(uniform(rng, 0, 1));
+			return ref_point(r * cos(u), rng() & 1 ? 1 : -1, r * sin(u));
+		};
+		c.origin = [](Rng &rng) 
+		{
+			RefPoint d = random_direction(rng);
+			return ref_normalize(ref_point(0.3 * d.x, d.y < 0 ? -1 : 1, 0.3 * d.z));
+		};
+		cases.push_back(c);
+	}
+	// a box and a rounded polyhedron of tangent planes, the box shows the
+	// cost of a single block, the other one of many
+	const int num_planes[] = { 6, 128 };
+	for(int k = 0; k < 2; ++k)
+	{
+		PolyhedronObject *poly = arena.create<PolyhedronObject>();
+		std::vector<RefPoint> normals;
+		for(int i = 0; i < num_planes[k]; ++i)
+		{
+			RefPoint n;
+			if(num_planes[k] == 6)
+				n = ref_point(i / 2 == 0 ? (i & 1 ? -1 : 1) : 0, i / 2 == 1 ? (i & 1 ? -1 : 1) : 0, i / 2 == 2 ? (i & 1 ? -1 : 1) : 0);
+			else
+			{
+				// evenly spread over the sphere
+				double y = 1 - 2 * (i + 0.5) / num_planes[k], r = sqrt(1 - y * y), phi = i * 2.399963229728653;
+				n = ref_point(r * cos(phi), y, r * sin(phi));
+			}
+			normals.push_back(n);
+			poly->planes.push_back(Plane((float)n.x, (float)n.y, (float)n.z, -1.0f));
+		}
+		poly->build();
+		PrimitiveCase c;
+		c.name = num_planes[k] == 6 ? "polyhedron 6" : "polyhedron 128";
+		c.object = poly;
+		c.precision = "float";
+		c.float_kernel = c.double_kernel = NULL;
+		c.radius = num_planes[k] == 6 ? sqrt(3.0) : 1.1;
+		c.distance = [normals](const RefPoint &p)
+		{
+			double d = -1e30;
+			for(size_t i = 0; i < normals.size(); ++i)
+				d = std::max(d, ref_dot(normals[i], p) - 1);
+			return d;
+		};
+		c.target = [](Rng &rng) { RefPoint d = random_direction(rng); double r = 0.99 * cbrt(uniform(rng, 0, 1)); return ref_point(d.x * r, d.y * r, d.z * r); };
+		c.origin = any_side;
+		cases.push_back(c);
+	}
+
+	for(size_t i = 0; i < cases.size(); ++i)
+	{
+		cases[i].object->calculate_matrices();
+		cases[i].kernel = build_kernel;
+	}
+	return cases;
+}
+
+// the cases with the kernels of the precision asked for: the one of the
+// build, float, double or all of them. the float only primitives are
+// measured once
+static std::vector<PrimitiveCase> select_precision(const std::vector<PrimitiveCase> &cases, const std::string &precision)
+{
+	if(precision == "build")
+		return cases;
+	std::vector<PrimitiveCase> selected;
+	for(size_t i = 0; i < cases.size(); ++i)
+	{
+		PrimitiveCase c = cases[i];
+		if(!c.float_kernel)
+		{
+			selected.push_back(c);
+			continue;
+		}
+		if(precision == "float" || precision == "all")
+		{
+			c.kernel = c.float_kernel;
+			c.precision = "float";
+			selected.push_back(c);
+		}
+		if(precision == "double" || precision == "all")
+		{
+			c.kernel = c.double_kernel;
+			c.precision = "double";
+			selected.push_back(c);
+		}
+	}
+	return selected;
+}
+
+struct KernelResult
+{
+	double ratio;
+	double ns_per_ray;
+	double hit_rate;
+};
+
+struct AccuracyResult
+{
+	size_t rays;
+	size_t mismatches;	// hit by one of the kernel and the reference only
+	double mean_error, max_error, max_relative_error;
+};
+
+int run_primitive_bench(int argc, char **argv)
+{
+	bool quick = false;
+	size_t num_rays = 0;
+	std::string json_file;
+	std::string precision = "build";
+	for(int i = 0; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if(arg == "--quick")
+			quick = true;
+		else if(arg == "--rays" && i + 1 < argc)
+			num_rays = strtoul(argv[++i], NULL, 10);
+		else if(arg == "--json" && i + 1 < argc)
+			json_file = argv[++i];
+		else if(arg == "--precision" && i + 1 < argc && 
+			(std::string(argv[i + 1]) == "build" || std::string(argv[i + 1]) == "float" || 
+			std::string(argv[i + 1]) == "double" || std::string(argv[i + 1]) == "all"))
+			precision = argv[++i];
+		else
+		{
+			std::cerr << "primitive bench options: [--quick] [--rays N] [--json file] [--precision build|float|double|all]" << std::endl;
+			return 1;
+		}
+	}
+	if(num_rays == 0)
+		num_rays = quick ? 100000 : 1000000;
+	// the reference is slow, it checks a part of the hit rays
+	size_t num_checked = std::min<size_t>(num_rays, quick ? 5000 : 50000);
+	const int repeats = 3;
+
+	Arena arena;
+	std::vector<PrimitiveCase> cases = select_precision(make_cases(arena), precision);
+	std::vector<std::vector<KernelResult> > kernels(cases.size());
+	std::vector<AccuracyResult> accuracy(cases.size());
+
+	char line[200];
+	std::cout << "kernel precision policy: " << KernelPrecision::name() << std::endl;
+	snprintf(line, sizeof(line), "%-16s %-7s %6s %10s %9s", "primitive", "scalar", "hits", "ns/ray", "hit rate");
+	std::cout << line << std::endl;
+	for(size_t i = 0; i < cases.size(); ++i)
+	{
+		PrimitiveCase &c = cases[i];
+		Rng rng(1234 + i);
+		for(size_t r = 0; r < sizeof(hit_ratios) / sizeof(hit_ratios[0]); ++r)
+		{
+			RayBatch batch = make_rays(c, num_rays, hit_ratios[r], rng);
+			KernelResult res;
+			res.ratio = hit_ratios[r];
+			res.ns_per_ray = 1e30;
+			size_t hits = 0;
+			for(int k = 0; k < repeats; ++k)
+			{
+				double sum = 0;
+				hits = 0;
+				double start = now();
+				for(size_t j = 0; j < batch.rays.size(); ++j)
+				{
+					Vector normal;
+					bool inside = false;
+					float t = c.kernel(c.object, batch.rays[j], normal, &inside);
+					if(t > FLT_EPSILON && t < FLT_MAX)
+					{
+						++hits;
+						sum += t;
+					}
+				}
+				double elapsed = now() - start;
+				res.ns_per_ray = std::min(res.ns_per_ray, elapsed * 1e9 / batch.rays.size());
+				distance_sink = sum;
+			}
+			res.hit_rate = (double)hits / batch.rays.size();
+			kernels[i].push_back(res);
+			snprintf(line, sizeof(line), "%-16s %-7s %5.0f%% %10.2f %8.1f%%", c.name.c_str(), c.precision.c_str(), 
+				100 * res.ratio, res.ns_per_ray, 100 * res.hit_rate);
+			std::cout << line << std::endl;
+
+			if(hit_ratios[r] != 1.0)
+				continue;
+
+			// distances of the aimed rays against the reference
+			AccuracyResult &acc = accuracy[i];
+			acc.rays = num_checked;
+			acc.mismatches = 0;
+			acc.mean_error = acc.max_error = acc.max_relative_error = 0;
+			size_t compared = 0;
+			for(size_t j = 0; j < num_checked; ++j)
+			{
+				Vector normal;
+				bool inside = false;
+				float t = c.kernel(c.object, batch.rays[j], normal, &inside);
+				bool hit = t > FLT_EPSILON && t < FLT_MAX;
+				double ref = reference_hit(c, batch.ref_origins[j], batch.ref_dirs[j]);
+				if(hit != (ref > 0))
+				{
+					++acc.mismatches;
+					continue;
+				}
+				if(!hit)
+					continue;
+				double err = std::abs(t - ref);
+				acc.mean_error += err;
+				acc.max_error = std::max(acc.max_error, err);
+				acc.max_relative_error = std::max(acc.max_relative_error, err / ref);
+				++compared;
+			}
+			if(compared > 0)
+				acc.mean_error /= compared;
+		}
+	}
+
+	std::cout << std::endl;
+	snprintf(line, sizeof(line), "%-16s %-7s %8s %10s %12s %12s %12s", "primitive", "scalar", "checked", "mismatch", "mean error", "max error", "max rel");
+	std::cout << line << std::endl;
+	for(size_t i = 0; i < cases.size(); ++i)
+	{
+		const AccuracyResult &acc = accuracy[i];
+		snprintf(line, sizeof(line), "%-16s %-7s %8zu %10zu %12.3g %12.3g %12.3g", cases[i].name.c_str(), cases[i].precision.c_str(), acc.rays, 
+			acc.mismatches, acc.mean_error, acc.max_error, acc.max_relative_error);
+		std::cout << line << std::endl;
+	}
+
+	if(json_file.empty())
+		return 0;
+	std::ofstream out(json_file.c_str());
+	if(!out)
+	{
+		std::cerr << "Failed to open benchmark output (" << json_file << ")." << std::endl;
+		return 1;
+	}
+	out << "{\n  \"rays\": " << num_rays << ",\n  \"policy\": \"" << KernelPrecision::name() << "\",\n  \"primitives\": [\n";
+	for(size_t i = 0; i < cases.size(); ++i)
+	{
+		const AccuracyResult &acc = accuracy[i];
+		out << "    {\n      \"name\": \"" << cases[i].name << "\",\n      \"precision\": \"" << cases[i].precision 
+			<< "\",\n      \"kernels\": [";
+		for(size_t r = 0; r < kernels[i].size(); ++r)
+			out << (r ? ", " : "") << "{ \"hit_ratio\": " << kernels[i][r].ratio << ", \"ns_per_ray\": " << kernels[i][r].ns_per_ray 
+				<< ", \"hit_rate\": " << kernels[i][r].hit_rate << " }";
+		out << "],\n      \"accuracy\": { \"checked\": " << acc.rays << ", \"mismatches\": " << acc.mismatches 
+			<< ", \"mean_error\": " << acc.mean_error << ", \"max_error\": " << acc.max_error 
+			<< ", \"max_relative_error\": " << acc.max_relative_error << " }\n    }" << (i + 1 < cases.size() ? "," : "") << "\n";
+	}
+	out << "  ]\n}\n";
+	return 0;
+}
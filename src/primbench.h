@@ -0,0 +1,30 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#ifndef PRIMBENCH_H
+#define PRIMBENCH_H
+
+// Intersection kernels measured in isolation: batches of random rays with
+// a fixed share of hits are traced against one object of each type. It
+// reports the time per ray and the hit rate, and compares the distances
+// with a double precision reference.
+// --precision measures the kernels of the build's precision policy, the
+// float or double ones, or both side by side.
+//
+// options: [--quick] [--rays N] [--json file] [--precision build|float|double|all]
+int run_primitive_bench(int argc, char **argv);
+
+#endif
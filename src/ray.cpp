@@ -16,6 +16,6 @@
 */
 #include "ray.h"
 
-Ray::Ray(Point o, Vector d)
-	: origin(o), direction(d)
+Ray::Ray(Point o, Vector d, float t, size_t s)
+	: origin(o), direction(d), time(t), sample(s), cone_width(0), cone_spread(0)
 {}
\ No newline at end of file
@@ -23,12 +23,36 @@
 class Ray
 {
 public:
-	Ray(){}
-	Ray(Point o, Vector d);
+	Ray() : time(0), sample(0), cone_width(0), cone_spread(0) {}
+	Ray(Point o, Vector d, float t = 0, size_t s = 0);
 	~Ray(){}
 
+	// width of the ray cone at a point of the ray
+	inline float cone_width_at(const Point &p) const { return cone_width + cone_spread * (float)Point::distance(origin, p); }
+	// a reflected or refracted ray goes on with the cone of its parent
+	// where it hit p. The curvature of the surface is not followed.
+	inline void continue_cone(const Ray &parent, const Point &p)
+	{
+		cone_width = parent.cone_width_at(p);
+		cone_spread = parent.cone_spread;
+	}
+
 	Point origin;
 	Vector direction;
+	float time;		// time inside the shutter interval, in seconds
+	size_t sample;	// pixel sample that spawned the ray
+	// cone around the ray covering its share of the pixel, it sizes the
+	// texture lookups: width at the origin and growth per unit of distance
+	float cone_width;
+	float cone_spread;
+};
+
+// ray cone where it hits a surface
+struct RayFootprint
+{
+	Vector direction;	// of the ray
+	Vector normal;		// of the surface, normalized
+	float width;		// of the cone at the hit
 };
 
 inline std::ostream &operator<<(std::ostream &stream, const Ray &ray) 
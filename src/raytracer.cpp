@@ -15,17 +15,54 @@
 * Universidade Federal de Minas Gerais (UFMG) 
 */
 #include "raytracer.h"
-#include "ppmimage.h"
+#include "timeline.h"
 #include <fstream>
 
 #define SATURATE(a) std::max(a, 0.0f)
 
 void Raytracer::compute(Scene &scene) 
 {
-	if(scene.screen.samples > 1)
+	TIMELINE_SCOPE("render");
+	occluder_cache.assign(scene.lights.size(), NULL);
+	occluder_cache_hits = 0;
+	rays = RayCounts();
+	stats = RenderStats();
+	hit_tests = 0;
+	if(heatmap != HeatmapNone)
+		pixel_costs.create(scene.screen.width_px, scene.screen.height_px);
+	shadow_blocked = 0;
+	// the temporaries of a trace call fit in the first scratch block
+	scratch.allocate(sizeof(size_t) * scene.lights.size());
+	scratch.reset();
+
+	stages = WavefrontStats();
+	bool wave = wavefront && (scene.screen.samples <= 1 || scene.dynamic_objects.empty());
+	if(wavefront && !wave && verbose)
+		std::cout << "moving objects with several samples per pixel, rendering recursively" << std::endl;
+
+	if(wave)
+		compute_wavefront(scene);
+	else if(scene.screen.samples > 1)
 		compute_sampled(scene);
 	else
 		compute_regular(scene);
+
+	if(heatmap != HeatmapNone)
+		pixel_costs.save(scene.output, heatmap);
+	STAT(stats.rays = rays);
+
+	if(!verbose)
+		return;
+#ifdef RAYTRACER_STATS
+	std::cout << "heap allocations while rendering: " << render_allocations << std::endl;
+	if(shadow_blocked > 0)
+		std::cout << "shadow rays: " << rays.shadow << ", blocked: " << shadow_blocked 
+			<< ", occluder cache hits: " << occluder_cache_hits 
+			<< " (" << (100.0 * occluder_cache_hits) / shadow_blocked << "% of blocked)" << std::endl;
+#endif
+	STAT(stats.print(std::cout));
+	if(wave)
+		stages.print(std::cout);
 }
 
 Vector Raytracer::get_ray_direction(Scene &scene, int w, int h, const Point &ori, const Point &lp, const Point &sp)
@@ -79,25 +116,53 @@ Vector Raytracer::get_ray_direction(Scene &scene, int w, int h)
 	return dir.normalize();
 }
 
+float Raytracer::get_shutter_weight(Scene &scene)
+{
+	// the image is the sum of one exposure per shutter step
+	float ev = scene.camera.exposure/scene.camera.shutter_time;
+	float weight = 0;
+	for(float dt = 0; dt < scene.camera.shutter_time; dt+= scene.camera.exposure)
+		weight += ev;
+	return weight;
+}
+
+inline void Raytracer::begin_pixel()
+{
+	if(heatmap == HeatmapNone)
+		return;
+	pixel_rays = rays.total();
+	pixel_hit_tests = hit_tests;
+	pixel_start = std::chrono::steady_clock::now();
+}
+
+inline void Raytracer::end_pixel(size_t w, size_t h)
+{
+	if(heatmap == HeatmapNone)
+		return;
+	PixelCost cost;
+	cost.nanoseconds = (float)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - pixel_start).count();
+	cost.rays = (float)(rays.total() - pixel_rays);
+	cost.hit_tests = (float)(hit_tests - pixel_hit_tests);
+	pixel_costs.set(w, h, cost);
+}
+
 void Raytracer::compute_regular(Scene &scene)
 {
 	Screen sc = scene.screen;
 
 	//ray origin is fixed from camera pos, direction will be calculated later
 	Ray ray(scene.camera.pos, Vector());
-
-	//output file
-	PPMImage output;
-	output.create(sc.width_px, sc.height_px);
+	ray.cone_spread = camera_cone_spread(scene);
 
 	float ev = scene.camera.exposure/scene.camera.shutter_time;
+	float shutter_weight = get_shutter_weight(scene);
 	// for each pixel of the virtual screen, calculate the color.
-    for(size_t h = 0; h < sc.height_px; ++h) 
+	render_bands(scene, [&](FrameOutput &output, const PixelTraversal &pixels, size_t top, size_t t)
 	{
-		std::cout << "calculating row " << h << " of " << sc.height_px << "\r";
-		std::cout.flush();
-        for(size_t w = 0; w < sc.width_px; ++w) 
+        pixels.for_each_pixel(t, [&](size_t w, size_t h)
 		{
+			h += top;
             // Get the pixel position.
             //Point pos = sc.top_left;
             //pos += w * px_right;
@@ -111,22 +176,39 @@ void Raytracer::compute_regular(Scene &scene)
 			//dir.normalize();
             // Get a vector width the distance between the camera and the pixel.
 			//ray.direction = (pos - scene.camera.pos).normalize();
+			begin_pixel();
 			Color p;
-			for(float dt = 0; dt < scene.camera.shutter_time; dt+= scene.camera.exposure)
+			ray.direction = get_ray_direction(scene, w, h);
+			ray.sample = h * sc.width_px + w;
+			if(scene.dynamic_objects.empty())
 			{
-				//delta time in millisseconds
-				float delta_time = dt/1000;
-				for(auto it = scene.objects.begin(); it != scene.objects.end(); ++it) 
-					(*it)->calculate_matrices(delta_time);
+				// nothing moves, every shutter step would trace the same image
+				++rays.camera;
+				p = trace(scene, ray, max_depth) * shutter_weight;
+			}
+			else
+			{
+				// the camera does not move, so the hit on the static objects
+				// is shared by every shutter step
+				PrimaryHit primary;
+				ray.time = 0;
+				find_primary_hit(scene, ray, primary);
+				for(float dt = 0; dt < scene.camera.shutter_time; dt+= scene.camera.exposure)
+				{
+					//delta time in millisseconds
+					float delta_time = dt/1000;
+					for(auto it = scene.dynamic_objects.begin(); it != scene.dynamic_objects.end(); ++it) 
+						(*it)->calculate_matrices(delta_time);
 
-				ray.direction = get_ray_direction(scene, w, h);
-				p += trace(scene, ray, max_depth) * ev;
+					ray.time = delta_time;
+					++rays.camera;
+					p += trace_primary(scene, ray, primary) * ev;
+				}
 			}
+			end_pixel(w, h);
 			output.set_color(w, h, p);
-        }
-    }
-	if(!output.save(scene.output))
-		std::cerr << "Failed to save output file: " << scene.output << std::endl;
+        });
+    });
 }
 
 void  Raytracer::compute_sampled(Scene &scene)
@@ -134,21 +216,20 @@ void  Raytracer::compute_sampled(Scene &scene)
 	int num_samples = scene.screen.samples;
 	float inv_samples = 1.0/num_samples;
 	sampler = MultiJittered(num_samples);
+	if(!scene.dynamic_objects.empty())
+		time_sampler = MultiJittered(num_samples);
 	
 	Screen sc = scene.screen;
+	float cone_spread = camera_cone_spread(scene);
 
-	//output file
-	PPMImage output;
-	output.create(sc.width_px, sc.height_px);
 	// for each pixel of the virtual screen, calculate the color.
-
-	float ev = scene.camera.exposure/scene.camera.shutter_time;
-    for(size_t h = 0; h < sc.height_px; ++h) 
+	float shutter_weight = get_shutter_weight(scene);
+	render_bands(scene, [&](FrameOutput &output, const PixelTraversal &pixels, size_t top, size_t t)
 	{
-		std::cout << "calculating row " << h << " of " << sc.height_px << "\r";
-		std::cout.flush();
-        for(size_t w = 0; w < sc.width_px; ++w) 
+        pixels.for_each_pixel(t, [&](size_t w, size_t h)
 		{
+			h += top;
+			begin_pixel();
 			Color p;
 			for(int j = 0; j < num_samples; j++)
 			{
@@ -161,23 +242,67 @@ void  Raytracer::compute_sampled(Scene &scene)
 				ray.origin = scene.camera.pos + lp.x * scene.camera.x + lp.y * scene.camera.y;
 				// Get a vector width the distance between the camera and the pixel.
 				ray.direction = get_ray_direction(scene, w, h, ray.origin, lp, sp);
+				ray.sample = (h * sc.width_px + w) * num_samples + j;
+				ray.cone_spread = cone_spread;
 				
-				Color e;
-				for(float dt = 0; dt < scene.camera.shutter_time; dt+= scene.camera.exposure)
+				if(!scene.dynamic_objects.empty())
 				{
-					//delta time in millisseconds
-					float delta_time = dt/1000;
-					for(auto it = scene.objects.begin(); it != scene.objects.end(); ++it) 
-						(*it)->calculate_matrices(delta_time);
-
-					e += trace(scene, ray, max_depth) * ev;
+					// every camera sample sees the scene at one stratified
+					// time inside the shutter interval (in seconds)
+					ray.time = time_sampler.sample_unit_square().x * scene.camera.shutter_time / 1000;
+					for(auto it = scene.dynamic_objects.begin(); it != scene.dynamic_objects.end(); ++it) 
+						(*it)->calculate_matrices(ray.time);
 				}
+
+				++rays.camera;
+				Color e = trace(scene, ray, max_depth) * shutter_weight;
 				p += e * inv_samples;
 			}
+			end_pixel(w, h);
 			output.set_color(w, h, p);
-        }
-    }
-	if(!output.save(scene.output))
+        });
+    });
+}
+
+void Raytracer::render_bands(Scene &scene, 
+	const std::function<void(FrameOutput &output, const PixelTraversal &pixels, size_t top, size_t tile)> &render_tile)
+{
+	Screen &sc = scene.screen;
+	FrameOutput output;
+	if(!output.open(scene.output, sc.width_px, sc.height_px, band_rows, framebuffer))
+		return;
+
+	const char *tile_name = order == ScanlineOrder ? "row" : "tile";
+	size_t num_bands = output.num_bands();
+	size_t allocations = heap_allocations();
+	for(size_t b = 0; b < num_bands; ++b)
+	{
+		size_t top = output.band_start(b);
+		PixelTraversal pixels(order, sc.width_px, output.band_height(b));
+		for(size_t t = 0; t < pixels.num_tiles(); ++t) 
+		{
+			TIMELINE_SCOPE(order == ScanlineOrder ? "render row" : "render tile");
+			if(verbose)
+			{
+				if(num_bands > 1)
+					std::cout << "calculating band " << b << " of " << num_bands << ", " << tile_name << " " << t << " of " << pixels.num_tiles() << "\r";
+				else
+					std::cout << "calculating " << tile_name << " " << t << " of " << pixels.num_tiles() << "\r";
+				std::cout.flush();
+			}
+			render_tile(output, pixels, top, t);
+		}
+		if(!output.end_band())
+			break;
+	}
+	render_allocations = heap_allocations() - allocations;
+	if(verbose)
+	{
+		// ends the progress line
+		std::cout << std::endl;
+		output.print(std::cout);
+	}
+	if(!output.close())
 		std::cerr << "Failed to save output file: " << scene.output << std::endl;
 }
 
@@ -186,25 +311,83 @@ Color Raytracer::trace(Scene &scene, const Ray &r, size_t depth, Object *exclude
     bool inside = false;
 	Intersection intersec;
 
+	STAT(++stats.traces[std::min<size_t>(max_depth - depth, STATS_MAX_DEPTH - 1)]);
+
     // if ray didn't intersect anything, return ambient color
     if(!intersection(scene, r, intersec, NULL, excluded_obj, &inside))
+	{
+		STAT(++stats.trace_misses);
         return scene.ambient.color;
+	}
+	return shade(scene, r, intersec, inside, depth);
+}
+
+void Raytracer::find_primary_hit(Scene &scene, const Ray &ray, PrimaryHit &primary)
+{
+	Vector n;
+	bool obj_inside = false;
+	primary.t = FLT_MAX;
+	primary.inside = false;
+	Object *obj = closest_hit(scene, ray, primary.t, n, obj_inside, NULL, NULL, StaticOnly);
+	primary.hit = obj != NULL;
+	if(primary.hit)
+		set_intersection(ray, obj, primary.t, n, obj_inside, primary.intersec, &primary.inside);
+}
 
+Color Raytracer::trace_primary(Scene &scene, const Ray &r, const PrimaryHit &primary)
+{
+	STAT(++stats.traces[0]);
+
+	// only moving objects in front of the static hit can change it
+	float t = primary.hit ? primary.t : FLT_MAX;
+	Vector n;
+	bool obj_inside = false;
+	Object *moving = closest_hit(scene, r, t, n, obj_inside, NULL, NULL, MovingOnly);
+
+	Intersection intersec;
+	bool inside = false;
+	if(moving)
+		set_intersection(r, moving, t, n, obj_inside, intersec, &inside);
+	else if(primary.hit)
+	{
+		intersec = primary.intersec;
+		inside = primary.inside;
+	}
+	else
+	{
+		STAT(++stats.trace_misses);
+		return scene.ambient.color;
+	}
+	return shade(scene, r, intersec, inside, max_depth);
+}
+
+Color Raytracer::shade(Scene &scene, const Ray &r, Intersection &intersec, bool inside, size_t depth)
+{
 	Material mat = intersec.object.material;
+	// rays leaving an object are not tested against it again, unless its
+	// parts can hide each other. Those rays start off the surface instead.
+	Object *leaving = intersec.object.self_occluding() ? NULL : &intersec.object;
 
+	// normalized once, every light sample sees the same normal
+	intersec.normal.normalize();
     Color amb_clr = scene.ambient.color * mat.kA;
     Color diff_clr;
     Color spec_clr;
 
-    // try reach every light source
-    for(std::vector<Light>::iterator it = scene.lights.begin(); it != scene.lights.end(); ++it) 
+    // try reach every light source close enough to lit the point
+	Arena::Mark scratch_mark = scratch.mark();
+	size_t *near_lights = scratch.allocate_array<size_t>(scene.lights.size());
+	size_t num_near = scene.gather_lights(intersec.contact, near_lights);
+    for(size_t i = 0; i < num_near; ++i) 
 	{
         // light direction
-		Light lt = *it;
+		const Light &lt = scene.lights[near_lights[i]];
 		float inv_samples = 1.0f/lt.num_samples;
+		// light positions of the sample set picked by this pixel sample
+		const Point *light_points = lt.get_points(r.sample);
 		for( int j = 0; j < lt.num_samples; j++) 
 		{
-			Point light_pos = lt.get_point();
+			const Point &light_pos = light_points[j];
 			//Vector lightDir = (it->pos - intersec.contact).normalize();
 			Vector lightDir = (light_pos - intersec.contact).normalize();
 
@@ -213,13 +396,12 @@ Color Raytracer::trace(Scene &scene, const Ray &r, size_t depth, Object *exclude
 			float dist = Point::distance(light_pos, intersec.contact);
 
 			// attenuation.
-			float att = 1.0f / (it->att.a + dist * it->att.b + (dist * dist) * it->att.c);
+			float att = 1.0f / (lt.att.a + dist * lt.att.b + (dist * dist) * lt.att.c);
 
-			Intersection useless;
-			Ray rl(intersec.contact, lightDir);
+			Ray rl(ray_start(r, intersec, lightDir), lightDir, r.time);
 			//if ray didn't intersects any object, it reaches the light
 			//if(!intersection(scene, rl, useless, &it->pos, &intersec.object)) 
-			if(!intersection(scene, rl, useless, &it->pos, &intersec.object)) 
+			if(!occluded(scene, rl, lt, leaving)) 
 			{
 				// diffuse light.
 				float cosDiff = SATURATE(Vector::dot(lightDir, intersec.normal));
@@ -233,7 +415,7 @@ Color Raytracer::trace(Scene &scene, const Ray &r, size_t depth, Object *exclude
 				halfway.normalize();
 
 				// cos of the angle between the halfway vector and the normal.
-				float cosSpec = SATURATE(Vector::dot(halfway, intersec.normal.normalize()));
+				float cosSpec = SATURATE(Vector::dot(halfway, intersec.normal));
 
 				// Shininess.
 				cosSpec = std::pow(cosSpec, mat.alpha);
@@ -242,6 +424,8 @@ Color Raytracer::trace(Scene &scene, const Ray &r, size_t depth, Object *exclude
 			}
 		}
     }
+	// the recursive calls reuse the scratch memory
+	scratch.rewind(scratch_mark);
 
     Color reflect_clr;
     Color refract_clr;
@@ -253,8 +437,10 @@ Color Raytracer::trace(Scene &scene, const Ray &r, size_t depth, Object *exclude
 		{
 			// reflected component added in recursively.
 			Vector reflect_dir = get_reflection_direction(r.direction, intersec.normal);
-			Ray reflec_ray(intersec.contact, reflect_dir);
-			reflect_clr += trace(scene, reflec_ray, depth - 1, &intersec.object) * mat.kR;
+			Ray reflec_ray(ray_start(r, intersec, reflect_dir), reflect_dir, r.time, r.sample);
+			reflec_ray.continue_cone(r, intersec.contact);
+			++rays.reflection;
+			reflect_clr += trace(scene, reflec_ray, depth - 1, leaving) * mat.kR;
 		}
 
 
@@ -269,13 +455,15 @@ Color Raytracer::trace(Scene &scene, const Ray &r, size_t depth, Object *exclude
 			Vector trans_dir;
 			if(get_transmission_direction(refr_rate, r.direction, intersec.normal, trans_dir)) 
 			{
-				Ray refrac_ray(intersec.contact, trans_dir);
-				refract_clr += trace(scene, refrac_ray, depth - 1, &intersec.object) * mat.kT;
+				Ray refrac_ray(ray_start(r, intersec, trans_dir), trans_dir, r.time, r.sample);
+				refrac_ray.continue_cone(r, intersec.contact);
+				++rays.refraction;
+				refract_clr += trace(scene, refrac_ray, depth - 1, leaving) * mat.kT;
 			}
 		}
     }
 
-	Color surface_color = intersec.object.get_color(intersec.contact);
+	Color surface_color = this->surface_color(r, intersec);
 	Color final_color = (surface_color * (amb_clr + diff_clr) + spec_clr + reflect_clr + refract_clr);
 	final_color.clamp();
 	return final_color;
@@ -285,55 +473,174 @@ bool Raytracer::intersection(Scene &scene, const Ray &ray,
 		Intersection &intersection, const Point *max_pos, const Object *excluded_obj,
         bool *inside) 
 {
-    // temporarily store the intersections.
-    Object *closest_obj = NULL;
     float closest_t = FLT_MAX;
     bool closest_inside = false;
 	Vector closest_normal;
+	Object *closest_obj = closest_hit(scene, ray, closest_t, closest_normal, closest_inside, max_pos, excluded_obj, AnyMotion);
+    if(!closest_obj) 
+		return false;
+	set_intersection(ray, closest_obj, closest_t, closest_normal, closest_inside, intersection, inside);
+	return true;
+}
+
+Object *Raytracer::closest_hit(Scene &scene, const Ray &ray, float &closest_t, Vector &closest_normal, bool &closest_inside,
+	const Point *max_pos, const Object *excluded_obj, MotionFilter filter)
+{
+    // temporarily store the intersections.
+    Object *closest_obj = NULL;
     
-    // loop through all objects looking where it intersects.
-    for(auto it = scene.objects.begin(); it != scene.objects.end(); ++it) 
+	auto test = [&](Object *obj) 
 	{
         // if object is excluded, we are not taking into account
-        if(excluded_obj && excluded_obj->id == (*it)->id)
-			continue;
+        if(excluded_obj && excluded_obj->id == obj->id)
+			return false;
 
 		float t;
 		Vector n;
-		bool insided;
-		t = (*it)->hit_test(ray, n, max_pos, &insided);
+		bool insided = false;
+		t = obj->hit_test(ray, n, max_pos, &insided);
+		++hit_tests;
+		STAT(++stats.hit_tests[obj->type]);
+		STAT(if(t > FLT_EPSILON && t < FLT_MAX) ++stats.hits[obj->type]);
 
 		//if found closest until now, save info
 		if(t > FLT_EPSILON && t < closest_t) 
 		{
-            closest_obj = (*it);
+            closest_obj = obj;
             closest_t = t;
             closest_inside = insided;
 			closest_normal = n;
         }
-    }
+		return false;
+	};
+
+    // objects without bounds are always tested
+    for(auto it = scene.unbounded_objects.begin(); it != scene.unbounded_objects.end(); ++it) 
+		if(filter == AnyMotion || (*it)->is_static() == (filter == StaticOnly))
+			test(*it);
+
+	// the trees only visit objects whose bounds, at the ray time, are
+	// crossed before the closest hit found so far
+	if(filter != MovingOnly)
+		scene.static_bvh.traverse(ray, closest_t, [&](unsigned int i) { return test(scene.static_bvh_objects[i]); });
+	if(filter != StaticOnly)
+		scene.dynamic_bvh.traverse(ray, closest_t, [&](unsigned int i) { return test(scene.dynamic_bvh_objects[i]); });
+	return closest_obj;
+}
 
-    // if object was found.
-    if(closest_obj) 
+void Raytracer::set_intersection(const Ray &ray, Object *obj, float t, const Vector &normal, bool obj_inside, 
+	Intersection &intersection, bool *inside)
+{
+	intersection.contact = ray.origin + t * ray.direction;
+	intersection.object = *obj;
+	intersection.normal = normal;
+	
+	// check if camera is inside hit sphere or mesh.
+	if(intersection.object.type == ObjectType::Sphere || intersection.object.self_occluding()) 
 	{
-		intersection.contact = ray.origin + closest_t * ray.direction;
-		intersection.object = *closest_obj;
-		intersection.normal = closest_normal;
-		
-		// check if camera is inside hit sphere.
-		if(intersection.object.type == ObjectType::Sphere) 
+		if(inside)	*inside = false;
+        if(obj_inside) 
 		{
-			if(inside)	*inside = false;
-            if(closest_inside) 
-			{
-				intersection.normal = intersection.normal * (-1);
-				if(inside)	*inside = true;
-            }
+			intersection.normal = intersection.normal * (-1);
+			if(inside)	*inside = true;
         }
-        return true;
     }
-    // no intersections.
-    return false;
+}
+
+Point Raytracer::ray_start(const Ray &ray, const Intersection &hit, const Vector &dir)
+{
+	if(!hit.object.self_occluding())
+		return hit.contact;
+	// move to the side of the surface the ray goes to
+	float offset = SELF_HIT_OFFSET * std::max(1.0, Point::distance(ray.origin, hit.contact));
+	if(Vector::dot(hit.normal, dir) < 0)
+		offset = -offset;
+	return hit.contact + hit.normal * offset;
+}
+
+float Raytracer::camera_cone_spread(Scene &scene)
+{
+	// pixels are one unit wide on the screen plane, at screen.d from the
+	// camera. Every sample covers a part of the pixel.
+	float spread = 1.0f / scene.screen.d;
+	if(scene.screen.samples > 1)
+		spread /= std::sqrt((float)scene.screen.samples);
+	return spread;
+}
+
+Color Raytracer::surface_color(const Ray &ray, const Intersection &hit)
+{
+	if(texture_filter == NearestFilter || hit.object.texture->type != MapTexture)
+		return hit.object.get_color(hit.contact);
+	RayFootprint footprint;
+	footprint.direction = ray.direction;
+	footprint.normal = hit.normal;
+	footprint.width = ray.cone_width_at(hit.contact);
+	return hit.object.get_color(hit.contact, &footprint);
+}
+
+bool Raytracer::occluded(Scene &scene, const Ray &ray, const Light &light, const Object *excluded_obj)
+{
+	++rays.shadow;
+
+	// neighbour shadow rays are usually blocked by the same object,
+	// so the last occluder of this light is tried first
+	Object *&cached = occluder_cache[light.id];
+	if(cached && !(excluded_obj && excluded_obj->id == cached->id))
+	{
+		Vector n;
+		float t = cached->hit_test(ray, n, &light.pos);
+		++hit_tests;
+		STAT(++stats.hit_tests[cached->type]);
+		STAT(if(t > FLT_EPSILON && t < FLT_MAX) ++stats.hits[cached->type]);
+		if(t > FLT_EPSILON && t < FLT_MAX)
+		{
+			++occluder_cache_hits;
+			++shadow_blocked;
+			return true;
+		}
+	}
+
+	Object *occluder = find_occluder(scene, ray, &light.pos, excluded_obj);
+	if(!occluder)
+		return false;
+	cached = occluder;
+	++shadow_blocked;
+	return true;
+}
+
+Object *Raytracer::find_occluder(Scene &scene, const Ray &ray, const Point *max_pos, const Object *excluded_obj)
+{
+	Object *occluder = NULL;
+
+	// any hit is enough, the search stops at the first one
+	auto test = [&](Object *obj) 
+	{
+        if(excluded_obj && excluded_obj->id == obj->id)
+			return false;
+
+		Vector n;
+		float t = obj->hit_test(ray, n, max_pos);
+		++hit_tests;
+		STAT(++stats.hit_tests[obj->type]);
+		STAT(if(t > FLT_EPSILON && t < FLT_MAX) ++stats.hits[obj->type]);
+		if(t > FLT_EPSILON && t < FLT_MAX) 
+		{
+			occluder = obj;
+			return true;
+		}
+		return false;
+	};
+
+    for(auto it = scene.unbounded_objects.begin(); it != scene.unbounded_objects.end(); ++it) 
+		if(test(*it))
+			return occluder;
+
+	float tmax = FLT_MAX;
+	scene.static_bvh.traverse(ray, tmax, [&](unsigned int i) { return test(scene.static_bvh_objects[i]); });
+	if(!occluder)
+		scene.dynamic_bvh.traverse(ray, tmax, [&](unsigned int i) { return test(scene.dynamic_bvh_objects[i]); });
+	return occluder;
 }
 
 Vector Raytracer::get_reflection_direction(const Vector &dir, const Vector &normal) 
@@ -353,6 +660,7 @@ bool Raytracer::get_transmission_direction(double refr_rate, const Vector &dir,
 	// internal reflection.
     if(c2 < -FLT_EPSILON) 
 	{ 
+		STAT(++stats.internal_reflections);
         Vector v = normal * 2 * c1;
         trans_dir = v - inv_dir;
         return true;
@@ -24,6 +24,18 @@
 #include "structs.h"
 #include "scene.h"
 #include "multijittered.h"
+#include "stats.h"
+#include "heatmap.h"
+#include "pixelorder.h"
+#include "wavefront.h"
+#include "frameoutput.h"
+#include <chrono>
+#include <functional>
+
+// distance from the surface where rays leaving self occluding objects
+// start, per unit of distance travelled by the ray that found the surface
+// (the hit error grows with it)
+#define SELF_HIT_OFFSET 1e-4f
 
 // intersection structure
 struct Intersection
@@ -33,10 +45,26 @@ struct Intersection
     Object object;	// intersected object
 };
 
+// Primary hit of a camera ray against the objects that do not move. It is
+// the same for every shutter step of the ray, so it is found once and kept
+// (G-buffer entry); the steps only test the moving objects in front of it.
+struct PrimaryHit
+{
+	bool hit;
+	bool inside;
+	float t;
+	Intersection intersec;
+};
+
 class Raytracer
 {
 public:
-	Raytracer(int max_ray_travel = 4){ max_depth = max_ray_travel;}
+	Raytracer(int max_ray_travel = 4)
+		: verbose(true), heatmap(HeatmapNone), order(ScanlineOrder), wavefront(false), band_rows(0), texture_filter(TrilinearFilter), render_allocations(0), occluder_cache_hits(0), shadow_blocked(0), hit_tests(0) 
+	{
+		max_depth = max_ray_travel;
+		rays = RayCounts();
+	}
 	~Raytracer(){}
 
 	// compute raytracing. trace a ray for every pixel
@@ -47,21 +75,117 @@ public:
 	Vector get_reflection_direction(const Vector &dir, const Vector &normal);
 	// get the transmission direction
 	bool get_transmission_direction(double refrRate, const Vector &dir, const Vector &normal, Vector &transDir);
+	// check if something blocks the ray before it reaches the light
+	bool occluded(Scene &scene, const Ray &ray, const Light &light, const Object *excluded_obj = NULL);
 	// check the ray intersection with the scene
 	bool intersection(Scene &scene, const Ray &ray, Intersection &interc, 
 		const Point *max_pos = NULL, const Object *excluded_obj = NULL,
         bool *inside = NULL);
 
+	inline const RayCounts &ray_counts() const { return rays; }
+	// empty unless built with RAYTRACER_STATS
+	inline const RenderStats &render_stats() const { return stats; }
+	// empty unless rendered by the wavefront renderer
+	inline const WavefrontStats &wavefront_stats() const { return stages; }
+
+	// print the progress and a summary of the render
+	bool verbose;
+	// save the render cost of every pixel next to the image, see heatmap.h
+	HeatmapMetric heatmap;
+	// order of the pixels, see pixelorder.h
+	PixelOrder order;
+	// render with the wavefront renderer, see wavefront.h. Scenes with
+	// several samples per pixel and moving objects keep the recursive one,
+	// every camera ray of them sees the objects at its own time.
+	bool wavefront;
+	// stream the image in bands of this many rows, see frameoutput.h. 0
+	// keeps the whole image and saves it at the end
+	size_t band_rows;
+	// keep the image in a disk backed tiled framebuffer instead, see
+	// tiledframebuffer.h
+	FramebufferSettings framebuffer;
+	// texture map lookups, see mipmap.h
+	TextureFilter texture_filter;
+
 private:
+	// objects looked at by a hit search
+	enum MotionFilter
+	{
+		AnyMotion,
+		StaticOnly,
+		MovingOnly
+	};
 
 	MultiJittered sampler;
+	// stratified shutter times, one per camera sample
+	MultiJittered time_sampler;
 	// max depth a ray can go recursively
 	int max_depth;
+	// temporary per ray data, each trace call gives back what it took
+	Arena scratch;
+	// operator new calls and arena blocks taken by the pixel loops
+	size_t render_allocations;
+	// last object that blocked a shadow ray, per light. One cache per
+	// Raytracer, cleared by every compute call.
+	std::vector<Object*> occluder_cache;
+	size_t occluder_cache_hits;
+	size_t shadow_blocked;
+	RayCounts rays;
+	RenderStats stats;
+	size_t hit_tests;
+
+	// cost of the pixel being computed, when a heatmap is saved
+	Heatmap pixel_costs;
+	std::chrono::steady_clock::time_point pixel_start;
+	size_t pixel_rays;
+	size_t pixel_hit_tests;
+
+	// queues of the wavefront renderer, kept from tile to tile
+	RayQueue extend_queue;
+	RayQueue spawn_queue;
+	HitQueue hit_queue;
+	ShadowQueue shadow_queue;
+	std::vector<PathNode> path_nodes;
+	WavefrontStats stages;
+
+	Object *find_occluder(Scene &scene, const Ray &ray, const Point *max_pos, const Object *excluded_obj);
+	// closest object hit before closest_t, which is updated
+	Object *closest_hit(Scene &scene, const Ray &ray, float &closest_t, Vector &normal, bool &obj_inside,
+		const Point *max_pos, const Object *excluded_obj, MotionFilter filter);
+	void set_intersection(const Ray &ray, Object *obj, float t, const Vector &normal, bool obj_inside, 
+		Intersection &intersection, bool *inside);
+	// shading of a hit, the recursive part of trace
+	Color shade(Scene &scene, const Ray &ray, Intersection &intersec, bool inside, size_t depth);
+	void find_primary_hit(Scene &scene, const Ray &ray, PrimaryHit &primary);
+	// trace a camera ray at one shutter step, given its primary hit
+	Color trace_primary(Scene &scene, const Ray &ray, const PrimaryHit &primary);
 
+	// renders every band of the image, calling render_tile for each row or
+	// tile of the pixel order, then saves the output. The rows of the band
+	// start at top.
+	void render_bands(Scene &scene, 
+		const std::function<void(FrameOutput &output, const PixelTraversal &pixels, size_t top, size_t tile)> &render_tile);
 	void compute_regular(Scene &scene);
 	void compute_sampled(Scene &scene);
-	inline Vector get_ray_direction(Scene &scene, int w, int h, const Point &ori,const Point &lp, const Point &sp);
-	inline Vector get_ray_direction(Scene &scene, int w, int h);
+	void compute_wavefront(Scene &scene);
+	// the stages of the wavefront renderer, from the camera rays in
+	// extend_queue to the colors of their path nodes
+	void wave_trace(Scene &scene);
+	void wave_extend(Scene &scene);
+	void wave_shade(Scene &scene);
+	void wave_shadow(Scene &scene);
+	void wave_spawn(size_t depth);
+	void wave_resolve(Scene &scene);
+	Vector get_ray_direction(Scene &scene, int w, int h, const Point &ori,const Point &lp, const Point &sp);
+	Vector get_ray_direction(Scene &scene, int w, int h);
+	float get_shutter_weight(Scene &scene);
+	Point ray_start(const Ray &ray, const Intersection &hit, const Vector &dir);
+	// angle a camera ray covers, its share of the pixel
+	float camera_cone_spread(Scene &scene);
+	// texture color at the hit, filtered by the footprint of the ray
+	Color surface_color(const Ray &ray, const Intersection &hit);
+	inline void begin_pixel();
+	inline void end_pixel(size_t w, size_t h);
 
 };
 #endif // !RAYTRACER_HPP
@@ -75,6 +75,31 @@ int Sampler::get_num_samples()
 	return (num_samples);
 }
 
+int Sampler::get_num_sets() 
+{
+	return (num_sets);
+}
+
+const std::vector<Point>& Sampler::get_unit_square_samples() const
+{
+	return (samples);
+}
+
+const std::vector<Point>& Sampler::get_disk_samples() const
+{
+	return (disk_samples);
+}
+
+const std::vector<Point>& Sampler::get_hemisphere_samples() const
+{
+	return (hemisphere_samples);
+}
+
+const std::vector<Point>& Sampler::get_sphere_samples() const
+{
+	return (sphere_samples);
+}
+
 void Sampler::shuffle_x_coordinates() 
 {
 	for (int p = 0; p < num_sets; p++)
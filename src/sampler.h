@@ -58,6 +58,17 @@ class Sampler
 		Point sample_sphere();										
 	
 		Point sample_one_set();												
+
+		int get_num_sets();
+
+		// sample sets, num_sets * num_samples points each
+		const std::vector<Point>& get_unit_square_samples() const;
+
+		const std::vector<Point>& get_disk_samples() const;
+
+		const std::vector<Point>& get_hemisphere_samples() const;
+
+		const std::vector<Point>& get_sphere_samples() const;
 		
 	protected:
 	
@@ -17,9 +17,19 @@
 #include "scene.h"
 #include "raytracer.h"
 #include "math/plane.h"
-#include <fstream>
+#include "scenefile.h"
+#include "timeline.h"
 #include <iostream>
 #include <cstdlib>
+#include <algorithm>
+#include <stdexcept>
+#include <exception>
+#include <thread>
+
+Scene::~Scene()
+{
+	delete camera.sampler;
+}
 
 void Scene::load_file(int argc, char **argv) 
 {
@@ -40,26 +50,147 @@ void Scene::load_file(int argc, char **argv)
         screen.width_px = strtoul(argv[3], NULL, 10);
         screen.height_px = strtoul(argv[4], NULL, 10);
     }
-    else
+
+	load(input);
+}
+
+void Scene::load(const char *file)
+{
+	TIMELINE_SCOPE("load scene");
+	// compiled scenes are mapped and read in place
+	MappedFile mapped;
+	if(mapped.open(file) && mapped.size() >= 4 && std::string(mapped.data(), 4) == SCENE_FILE_MAGIC)
 	{
-        screen.width_px = 800;
-        screen.height_px = 600;
-    }
+		if(!load_binary(mapped))
+		{
+			std::cerr << "Failed to load compiled scene (" << file << ")." << std::endl;
+			exit(1);
+		}
+		build_dynamic_acceleration();
+		build_light_tree();
+		return;
+	}
+	if(!mapped.is_open())
+	{
+		std::cerr << "Failed to open input file (" << file << ")." << std::endl;
+		exit(1);
+	}
 
-    // open the input file.
-    std::ifstream f_input(input);
-    if(!f_input.is_open())
-        printf("Failed to open input file (%s).", input);
+	// parse the input file in place.
+	try
+	{
+		TIMELINE_SCOPE("parse scene");
+		Tokenizer in(mapped.data(), mapped.data() + mapped.size(), file);
+		parse_camera(in);
+		parse_light(in);
+		parse_texture(in);
+		parse_material(in);
+		// optional shape groups, placed by instance objects
+		if(in.next_is("groups"))
+			parse_groups(in);
+		parse_object(in);
+	}
+	catch(const std::runtime_error &e)
+	{
+		std::cerr << e.what() << std::endl;
+		exit(1);
+	}
+	mapped.close();
+
+	build_acceleration();
+	build_light_tree();
+}
+
+void Scene::build_light_tree()
+{
+	TIMELINE_SCOPE("build light tree");
+	std::vector<BBox> spheres;
+	for(size_t i = 0; i < lights.size(); ++i) 
+	{
+		Light &light = lights[i];
+		light.compute_range(light_cutoff);
+		// too dim to be seen anywhere
+		if(light.range <= 0)
+			continue;
 
-    // parse the input file.
-    parse_camera(f_input);
-    parse_light(f_input);
-    parse_texture(f_input);
-    parse_material(f_input);
-    parse_object(f_input);
+		if(light.range == FLT_MAX)
+		{
+			global_lights.push_back(i);
+			continue;
+		}
+		Vector ext(light.range, light.range, light.range);
+		spheres.push_back(BBox(light.pos - ext, light.pos + ext));
+		light_bvh_ids.push_back(i);
+	}
+	light_bvh.build(spheres, spheres, 0, 0);
+}
 
-    // close the input file.
-    f_input.close();
+size_t Scene::gather_lights(const Point &p, size_t *ids)
+{
+	size_t count = std::copy(global_lights.begin(), global_lights.end(), ids) - ids;
+	light_bvh.query(p, [&](unsigned int i) 
+	{
+		const Light &light = lights[light_bvh_ids[i]];
+		if(Point::distance(p, light.pos) <= light.range)
+			ids[count++] = light.id;
+		return false;
+	});
+	// keep the scene order, so the result does not depend on the tree
+	std::sort(ids, ids + count);
+	return count;
+}
+
+void Scene::build_acceleration()
+{
+	TIMELINE_SCOPE("build acceleration");
+	std::vector<BBox> boxes;
+	for(auto it = objects.begin(); it != objects.end(); ++it) 
+	{
+		if(!(*it)->is_static())
+		{
+			dynamic_objects.push_back(*it);
+			continue;
+		}
+		(*it)->calculate_matrices();
+		BBox b = (*it)->bounds();
+		if(b.bounded())
+		{
+			static_bvh_objects.push_back(*it);
+			boxes.push_back(b);
+		}
+		else
+			unbounded_objects.push_back(*it);
+	}
+	static_bvh.build(boxes, boxes, 0, 0);
+	build_dynamic_acceleration();
+}
+
+void Scene::build_dynamic_acceleration()
+{
+	// moving objects are bounded at both ends of the shutter interval
+	// (time in seconds)
+	float t0 = 0;
+	float t1 = camera.shutter_time/1000;
+
+	std::vector<BBox> open, close;
+	for(auto it = dynamic_objects.begin(); it != dynamic_objects.end(); ++it) 
+	{
+		(*it)->calculate_matrices(t0);
+		BBox b0 = (*it)->bounds();
+		(*it)->calculate_matrices(t1);
+		BBox b1 = (*it)->bounds();
+		(*it)->calculate_matrices();
+
+		if(b0.bounded() && b1.bounded())
+		{
+			dynamic_bvh_objects.push_back(*it);
+			open.push_back(b0);
+			close.push_back(b1);
+		}
+		else
+			unbounded_objects.push_back(*it);
+	}
+	dynamic_bvh.build(open, close, t0, t1);
 }
 
 void Scene::calculate_cam_base()
@@ -73,20 +204,35 @@ void Scene::calculate_cam_base()
 	camera.y.normalize();
 }
 
-void Scene::parse_camera(std::ifstream &in) 
+void Scene::parse_camera(Tokenizer &in) 
 {
-    in >> camera.pos.x >> camera.pos.y >> camera.pos.z;
+	camera.pos.x = in.read_float("camera position");
+	camera.pos.y = in.read_float("camera position");
+	camera.pos.z = in.read_float("camera position");
+
+	camera.lookat.x = in.read_float("camera look at");
+	camera.lookat.y = in.read_float("camera look at");
+	camera.lookat.z = in.read_float("camera look at");
+	camera.up.x = in.read_float("camera up");
+	camera.up.y = in.read_float("camera up");
+	camera.up.z = in.read_float("camera up");
+
+	camera.fovy = in.read_float("camera fovy");
+	screen.samples = in.read_int("number of samples");
+	camera.lens_radius = in.read_float("lens radius");
+	camera.focal_length = in.read_float("focal length");
+	camera.shutter_time = in.read_float("shutter time");
+	camera.exposure = in.read_float("exposure");
+
+	setup_camera();
+}
 
-    in >> camera.lookat.x >> camera.lookat.y >> camera.lookat.z;
+void Scene::setup_camera()
+{
     camera.dir = camera.lookat - camera.pos;
     camera.dir.normalize();
-
-    in >> camera.up.x >> camera.up.y >> camera.up.z;
     camera.up.normalize();
 
-	in >> camera.fovy >> screen.samples >> camera.lens_radius >> camera.focal_dist;
-	in >> camera.shutter_time >> camera.exposure;
-	
 	calculate_cam_base();
 
 	// screen features
@@ -95,189 +241,360 @@ void Scene::parse_camera(std::ifstream &in)
 	screen.d = 0.5f * screen.height_px  / tan((M_PI/180.0)*0.5f*camera.fovy);
 	
 	// add viewplane distance to focal_distance	
-	camera.focal_dist += Point::distance(camera.pos, camera.lookat);
+	camera.focal_dist = camera.focal_length + Point::distance(camera.pos, camera.lookat);
 
 	// start camera sampler
 	camera.sampler = new MultiJittered(screen.samples);
 	camera.sampler->map_samples_to_unit_disk();
 }
 
-void Scene::parse_light(std::ifstream &in) 
+// points and vectors
+template<typename T> static void read_xyz(Tokenizer &in, T &v, const char *what)
 {
-    Light light;
+	v.x = in.read_float(what);
+	v.y = in.read_float(what);
+	v.z = in.read_float(what);
+}
 
-    in >> numLights;
-    if(in.fail())
-        printf("Failed to read the input file (light description)");
+static void read_color(Tokenizer &in, Color &c, const char *what)
+{
+	c.r = in.read_float(what);
+	c.g = in.read_float(what);
+	c.b = in.read_float(what);
+}
 
-    // ambient light.
-    in >> ambient.pos.x >> ambient.pos.y >> ambient.pos.z;
-    in >> ambient.color.r >> ambient.color.g >> ambient.color.b;
-    in >> ambient.att.a >> ambient.att.b >> ambient.att.c;
+static void read_attenuation(Tokenizer &in, Light &light)
+{
+	light.att.a = in.read_float("constant attenuation");
+	light.att.b = in.read_float("linear attenuation");
+	light.att.c = in.read_float("quadratic attenuation");
+}
+
+void Scene::parse_light(Tokenizer &in) 
+{
+	Light light;
 
-    // other lights.
-	std::string type;
-    for(size_t i = 1; i < numLights; ++i) 
+	numLights = in.read_size("number of lights");
+
+	// ambient light.
+	read_xyz(in, ambient.pos, "light position");
+	read_color(in, ambient.color, "light color");
+	read_attenuation(in, ambient);
+
+	// other lights.
+	for(size_t i = 1; i < numLights; ++i) 
 	{
-        in >> light.pos.x >> light.pos.y >> light.pos.z;
-        in >> light.color.r >> light.color.g >> light.color.b;
-        in >> light.att.a >> light.att.b >> light.att.c;
-		in >> type;
-		in >> light.num_samples >> light.area_size;
-		
-		light.build_area(type);
-        lights.push_back(light);
-    }
+		read_xyz(in, light.pos, "light position");
+		read_color(in, light.color, "light color");
+		read_attenuation(in, light);
+		Token type = in.next("light type");
+		light.num_samples = in.read_int("number of light samples");
+		light.area_size = in.read_float("light area size");
+
+		light.id = lights.size();
+		if(!light.build_area(type.str()))
+			in.error(type, "invalid light type '" + type.str() + "'");
+		lights.push_back(light);
+	}
 }
 
-void Scene::parse_texture(std::ifstream &in) 
+void Scene::parse_texture(Tokenizer &in) 
 {
-    std::string type;
-    Texture tex;
+	Texture tex;
 
-    in >> numTextures;
-    if(in.fail())
-        printf("Failed to read the input file (texture description).");
+	numTextures = in.read_size("number of textures");
 
-    for(size_t i = 0; i < numTextures; ++i) 
+	for(size_t i = 0; i < numTextures; ++i) 
 	{
-        tex.id = i;
-        in >> type;
+		tex.id = i;
+		Token type = in.next("texture type");
 
-        if(type == "solid") 
+		if(type == "solid") 
 		{
-            tex.type = SolidTexture;
-            in >> tex.solid.color.r >> tex.solid.color.g >> tex.solid.color.b;
-        }
-        else if(type == "checker") 
+			tex.type = SolidTexture;
+			read_color(in, tex.solid.color, "texture color");
+		}
+		else if(type == "checker") 
 		{
-            tex.type = CheckerTexture;
-            in >> tex.checker.color1.r >> tex.checker.color1.g
-                >> tex.checker.color1.b;
-            in >> tex.checker.color2.r >> tex.checker.color2.g
-                >> tex.checker.color2.b;
-            in >> tex.checker.scale;
-
-            tex.checker.map[0][0] = tex.checker.color1;
-            tex.checker.map[0][1] = tex.checker.color2;
-            tex.checker.map[1][0] = tex.checker.color1;
-            tex.checker.map[1][1] = tex.checker.color2;
-        }
-        else if(type == "texmap") 
+			tex.type = CheckerTexture;
+			read_color(in, tex.checker.color1, "checker color");
+			read_color(in, tex.checker.color2, "checker color");
+			tex.checker.scale = in.read_float("checker scale");
+
+			tex.checker.map[0][0] = tex.checker.color1;
+			tex.checker.map[0][1] = tex.checker.color2;
+			tex.checker.map[1][0] = tex.checker.color1;
+			tex.checker.map[1][1] = tex.checker.color2;
+		}
+		else if(type == "texmap") 
 		{
-            tex.type = MapTexture;
-            in >> tex.map.filename;
-            in >> tex.map.p0.x >> tex.map.p0.y >> tex.map.p0.z >> tex.map.p0.w;
-            in >> tex.map.p1.x >> tex.map.p1.y >> tex.map.p1.z >> tex.map.p1.w;
-            tex.map.image.load(tex.map.filename);
-        }
-        else 
+			tex.type = MapTexture;
+			Token file = in.next("texture file name");
+			tex.map.filename = file.str();
+			tex.map.p0.x = in.read_float("texture plane");
+			tex.map.p0.y = in.read_float("texture plane");
+			tex.map.p0.z = in.read_float("texture plane");
+			tex.map.p0.w = in.read_float("texture plane");
+			tex.map.p1.x = in.read_float("texture plane");
+			tex.map.p1.y = in.read_float("texture plane");
+			tex.map.p1.z = in.read_float("texture plane");
+			tex.map.p1.w = in.read_float("texture plane");
+			try
+			{
+				tex.map.mip.load(tex.map.filename);
+			}
+			catch(const std::runtime_error &e)
+			{
+				in.error(file, e.what());
+			}
+		}
+		else 
 		{
-            printf("invalid texture type (%s).", type.c_str());
-        }
-        textures.push_back(tex);
-    }
+			in.error(type, "invalid texture type '" + type.str() + "'");
+		}
+		textures.push_back(tex);
+	}
 }
 
-void Scene::parse_material(std::istream &in) 
+void Scene::parse_material(Tokenizer &in) 
 {
-    Material material;
+	Material material;
 
-    in >> numMaterials;
-    if(in.fail())
-        printf("Failed to read the input file (material description).");
+	numMaterials = in.read_size("number of materials");
 
-    for(size_t i = 0; i < numMaterials; ++i) 
+	for(size_t i = 0; i < numMaterials; ++i) 
 	{
-        material.id = i;
-        in >> material.kA >> material.kD >> material.kS >> material.alpha
-           >> material.kR >> material.kT >> material.ior;
-        materials.push_back(material);
-    }
+		material.id = i;
+		material.kA = in.read_float("kA");
+		material.kD = in.read_float("kD");
+		material.kS = in.read_float("kS");
+		material.alpha = in.read_float("alpha");
+		material.kR = in.read_float("kR");
+		material.kT = in.read_float("kT");
+		material.ior = in.read_float("ior");
+		materials.push_back(material);
+	}
 }
 
-void Scene::parse_object(std::istream &in) 
+// number of tokens after the object type, polyhedra read their planes
+// and the optional transform keyword
+static size_t object_record_size(Tokenizer &in, const Token &type)
 {
-    std::string type;
+	if(type == "sphere")
+		return 10;
+	if(type == "torus")
+		return 14;
+	if(type == "cylinder")
+		return 15;
+	if(type == "mesh" || type == "instance")
+		return 13;
+	if(type == "polyhedron")
+	{
+		in.skip(4 * in.read_size("number of faces"), "polyhedron planes");
+		return in.next_is("transform") ? 12 : 0;
+	}
+	in.error(type, "invalid object type '" + type.str() + "'");
+	return 0;
+}
 
-    in >> numObjects;
-    if(in.fail())
-        printf("Failed to read the input file (object description).");
+void Scene::parse_object(Tokenizer &in) 
+{
+	numObjects = in.read_size("number of objects");
 
-    for(size_t i = 0; i < numObjects; ++i) 
+	// records have a fixed number of tokens given their type, so a first
+	// pass only finds where each one starts and the numbers are converted
+	// by several threads
+	std::vector<Tokenizer::Mark> starts(numObjects);
 	{
-        int texId, matId;
-		in >> texId >> matId;
-        in >> type;
+		TIMELINE_SCOPE("find object records");
+		for(size_t i = 0; i < numObjects; ++i) 
+		{
+			starts[i] = in.mark();
+			in.skip(2, "object texture and material");
+			Token type = in.next("object type");
+			in.skip(object_record_size(in, type), "object description");
+		}
+	}
 
-        if(type == "sphere") 
+	size_t num_threads = std::thread::hardware_concurrency();
+	num_threads = std::max<size_t>(1, std::min(num_threads, numObjects / PARSE_CHUNK_MIN));
+
+	objects.assign(numObjects, NULL);
+	std::vector<std::exception_ptr> errors(num_threads);
+	// every thread fills its own arena, the scene takes them afterwards
+	std::vector<Arena> arenas(num_threads);
+	auto parse_chunk = [&](size_t chunk)
+	{
+		size_t first = numObjects * chunk / num_threads;
+		size_t last = numObjects * (chunk + 1) / num_threads;
+		TIMELINE_SCOPE("parse objects");
+		try
 		{
-			SphereObject* object = new SphereObject();
-			object->id = i;
-			object->texture = textures[texId];
-			object->material = materials[matId];
-
-			in >> object->original_pos.x >> object->original_pos.y >> object->original_pos.z;
-            in >> object->radius;
-			in >> object->original_scale.x >> object->original_scale.y >> object->original_scale.z;
-			in >> object->acceleration.x >> object->acceleration.y >> object->acceleration.z;
-			object->calculate_matrices();
-			objects.push_back(object);
-        }
-        else if(type == "polyhedron") 
+			Tokenizer t(in, starts[first]);
+			for(size_t i = first; i < last; ++i) 
+				objects[i] = parse_object_record(t, i, arenas[chunk]);
+		}
+		catch(...)
 		{
-			PolyhedronObject* object = new PolyhedronObject();
-			object->id = i;
-			object->texture = textures[texId];
-			object->material = materials[matId];
+			errors[chunk] = std::current_exception();
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for(size_t chunk = 1; chunk < num_threads; ++chunk)
+		workers.push_back(std::thread(parse_chunk, chunk));
+	parse_chunk(0);
+	for(size_t i = 0; i < workers.size(); ++i)
+		workers[i].join();
+	for(size_t i = 0; i < arenas.size(); ++i)
+		object_arena.take(arenas[i]);
+
+	// report the first error in the file
+	for(size_t i = 0; i < errors.size(); ++i)
+		if(errors[i])
+			std::rethrow_exception(errors[i]);
+}
+
+Object *Scene::parse_object_record(Tokenizer &in, size_t id, Arena &arena)
+{
+	size_t texId = in.read_index("texture index", textures.size());
+	size_t matId = in.read_index("material index", materials.size());
+	Object *object = parse_shape(in, in.next("object type"), arena);
+	object->id = id;
+	object->texture = &textures[texId];
+	object->material = materials[matId];
+	return object;
+}
 
-            in >> object->numFaces;
-            if(in.fail())
-                printf("Failed to read the input file (polyhedron description).");
+Object *Scene::parse_shape(Tokenizer &in, const Token &type, Arena &arena)
+{
+	if(type == "sphere") 
+	{
+		SphereObject* object = arena.create<SphereObject>();
+		read_xyz(in, object->original_pos, "sphere position");
+		object->radius = in.read_float("sphere radius");
+		read_xyz(in, object->original_scale, "sphere scale");
+		read_xyz(in, object->acceleration, "sphere acceleration");
+		object->calculate_matrices();
+		return object;
+	}
+	else if(type == "polyhedron") 
+	{
+		PolyhedronObject* object = arena.create<PolyhedronObject>();
+		object->numFaces = in.read_size("number of faces");
 
-            Plane plane;
-            for(size_t j = 0; j < object->numFaces; ++j) 
-			{
-                in >> plane.a >> plane.b >> plane.c >> plane.d;
-                object->planes.push_back(plane);
-            }
-			objects.push_back(object);
-        }
-		else if(type == "torus") 
+		Plane plane;
+		object->planes.reserve(object->numFaces);
+		for(size_t j = 0; j < object->numFaces; ++j) 
 		{
-			TorusObject* object = new TorusObject();
-			object->id = i;
-			object->texture = textures[texId];
-			object->material = materials[matId];
-
-			in >> object->radius >> object->thickness;
-			in >> object->original_pos.x >> object->original_pos.y >> object->original_pos.z;
-			in >> object->original_rot.x >> object->original_rot.y >> object->original_rot.z;
-			in >> object->original_scale.x >> object->original_scale.y >> object->original_scale.z;
-			in >> object->acceleration.x >> object->acceleration.y >> object->acceleration.z;
-			object->calculate_matrices();
-			objects.push_back(object);
+			plane.a = in.read_float("plane coefficient");
+			plane.b = in.read_float("plane coefficient");
+			plane.c = in.read_float("plane coefficient");
+			plane.d = in.read_float("plane coefficient");
+			object->planes.push_back(plane);
 		}
-		else if(type == "cylinder")
+		object->build();
+		if(in.next_is("transform"))
 		{
-			CylinderObject* object = new CylinderObject();
-			object->id = i;
-			object->texture = textures[texId];
-			object->material = materials[matId];
-
-			in >> object->bottom >> object->top >> object->radius;
-			in >> object->original_pos.x >> object->original_pos.y >> object->original_pos.z;
-			in >> object->original_rot.x >> object->original_rot.y >> object->original_rot.z;
-			in >> object->original_scale.x >> object->original_scale.y >> object->original_scale.z;
-			in >> object->acceleration.x >> object->acceleration.y >> object->acceleration.z;
-			object->calculate_matrices();
-			objects.push_back(object);
+			read_xyz(in, object->original_pos, "polyhedron position");
+			read_xyz(in, object->original_rot, "polyhedron rotation");
+			read_xyz(in, object->original_scale, "polyhedron scale");
+			read_xyz(in, object->acceleration, "polyhedron acceleration");
 		}
-        else 
-		{
-            printf("invalid object type(%s).", type.c_str());
-        }
-    }
+		object->calculate_matrices();
+		return object;
+	}
+	else if(type == "torus") 
+	{
+		TorusObject* object = arena.create<TorusObject>();
+		object->radius = in.read_float("torus radius");
+		object->thickness = in.read_float("torus thickness");
+		read_xyz(in, object->original_pos, "torus position");
+		read_xyz(in, object->original_rot, "torus rotation");
+		read_xyz(in, object->original_scale, "torus scale");
+		read_xyz(in, object->acceleration, "torus acceleration");
+		object->calculate_matrices();
+		return object;
+	}
+	else if(type == "cylinder")
+	{
+		CylinderObject* object = arena.create<CylinderObject>();
+		object->bottom = in.read_float("cylinder bottom");
+		object->top = in.read_float("cylinder top");
+		object->radius = in.read_float("cylinder radius");
+		read_xyz(in, object->original_pos, "cylinder position");
+		read_xyz(in, object->original_rot, "cylinder rotation");
+		read_xyz(in, object->original_scale, "cylinder scale");
+		read_xyz(in, object->acceleration, "cylinder acceleration");
+		object->calculate_matrices();
+		return object;
+	}
+	else if(type == "mesh")
+	{
+		MeshObject* object = arena.create<MeshObject>();
+		Token file = in.next("mesh file name");
+		object->mesh = load_mesh(file.str());
+		if(!object->mesh)
+			in.error(file, "failed to open mesh file " + file.str());
+		read_xyz(in, object->original_pos, "mesh position");
+		read_xyz(in, object->original_rot, "mesh rotation");
+		read_xyz(in, object->original_scale, "mesh scale");
+		read_xyz(in, object->acceleration, "mesh acceleration");
+		object->calculate_matrices();
+		return object;
+	}
+	else if(type == "instance")
+	{
+		InstanceObject* object = arena.create<InstanceObject>();
+		object->group = groups[in.read_index("group index", groups.size())];
+		read_xyz(in, object->original_pos, "instance position");
+		read_xyz(in, object->original_rot, "instance rotation");
+		read_xyz(in, object->original_scale, "instance scale");
+		read_xyz(in, object->acceleration, "instance acceleration");
+		object->calculate_matrices();
+		return object;
+	}
+
+	in.error(type, "invalid object type '" + type.str() + "'");
+	return NULL;
 }
 
+void Scene::parse_groups(Tokenizer &in)
+{
+	size_t num_groups = in.read_size("number of groups");
+	for(size_t i = 0; i < num_groups; ++i)
+	{
+		std::shared_ptr<ShapeGroup> group = std::make_shared<ShapeGroup>();
+		group->id = i;
+		size_t num_shapes = in.read_size("number of shapes");
+		for(size_t j = 0; j < num_shapes; ++j)
+		{
+			Token type = in.next("shape type");
+			Object *shape = parse_shape(in, type, group->arena);
+			group->shapes.push_back(shape);
+			shape->id = j;
+			// a shared shape has a single position, instances move instead
+			if(!shape->is_static())
+				in.error(type, "group shapes can not move, set the acceleration of the instances");
+		}
+		group->build();
+		// groups only refer to the ones defined before them
+		groups.push_back(group);
+	}
+}
 
+std::shared_ptr<TriangleMesh> Scene::load_mesh(const std::string &file)
+{
+	// objects are parsed by several threads
+	std::lock_guard<std::mutex> lock(mesh_mutex);
+	std::shared_ptr<TriangleMesh> &mesh = meshes[file];
+	if(!mesh)
+	{
+		std::shared_ptr<TriangleMesh> loaded = std::make_shared<TriangleMesh>();
+		if(!loaded->load_obj(file))
+			return std::shared_ptr<TriangleMesh>();
+		loaded->build();
+		mesh = loaded;
+	}
+	return mesh;
+}
@@ -20,13 +20,33 @@
 #include "object.h"
 #include "structs.h"
 #include "light.h"
+#include "bvh.h"
+#include "mappedfile.h"
+#include "tokenizer.h"
+#include "instance.h"
+#include "arena.h"
+#include <map>
+#include <mutex>
+
+// objects parsed by each thread at least
+#define PARSE_CHUNK_MIN 4096
 
 class Scene 
 {
 public:
-	Scene(){}
+	Scene() : light_cutoff(1.0f/256) 
+	{
+		screen.width_px = 800;
+		screen.height_px = 600;
+		camera.sampler = NULL;
+	}
+	~Scene();
 
 	void load_file(int argc, char **argv);
+	// load a text (.in) or compiled scene file
+	void load(const char *file);
+	// write the scene, with its acceleration data, in the compiled format
+	bool save_binary(const char *file);
 	void compute();
     
 	char *input;
@@ -38,6 +58,17 @@ public:
     size_t numLights;
     Light ambient;
     std::vector<Light> lights;
+	// intensity below which a light is ignored
+	float light_cutoff;
+	// lights reaching the whole scene, the others are found through a
+	// hierarchy of the spheres they can lit
+	std::vector<size_t> global_lights;
+	BVH light_bvh;
+	std::vector<size_t> light_bvh_ids;
+
+	// fill ids with the lights that may lit the point, in scene order.
+	// ids must hold every light, returns the number found
+	size_t gather_lights(const Point &p, size_t *ids);
 
     size_t numTextures;
     std::vector<Texture> textures;
@@ -46,14 +77,43 @@ public:
 	std::vector<Material> materials;
 
     size_t numObjects;
+	// objects live in the arena, which destroys them with the scene
+	Arena object_arena;
 	std::vector<Object*> objects;
+	// objects with non-zero acceleration, updated at every shutter time
+	std::vector<Object*> dynamic_objects;
+
+	// acceleration structures over the bounded objects, unbounded ones
+	// (e.g. open polyhedra) are tested one by one. The objects that do not
+	// move are in a tree built once, without motion; the moving ones are in
+	// a small tree over their bounds at both ends of the shutter.
+	BVH static_bvh;
+	std::vector<Object*> static_bvh_objects;
+	BVH dynamic_bvh;
+	std::vector<Object*> dynamic_bvh_objects;
+	std::vector<Object*> unbounded_objects;
+
+	// shared geometry: shape groups placed by instances and meshes by file
+	std::vector<std::shared_ptr<ShapeGroup> > groups;
+	std::map<std::string, std::shared_ptr<TriangleMesh> > meshes;
+	std::mutex mesh_mutex;
 
 protected:
+	void build_acceleration();
+	void build_dynamic_acceleration();
+	void build_light_tree();
+	bool load_binary(const MappedFile &file);
 	void calculate_cam_base();
-	void parse_camera(std::ifstream &in);
-	void parse_light(std::ifstream &in);
-	void parse_texture(std::ifstream &in);
-	void parse_material(std::istream &in);
-	void parse_object(std::istream &in);
+	void setup_camera();
+	void parse_camera(Tokenizer &in);
+	void parse_light(Tokenizer &in);
+	void parse_texture(Tokenizer &in);
+	void parse_material(Tokenizer &in);
+	void parse_object(Tokenizer &in);
+	void parse_groups(Tokenizer &in);
+	Object *parse_object_record(Tokenizer &in, size_t id, Arena &arena);
+	Object *parse_shape(Tokenizer &in, const Token &type, Arena &arena);
+	// meshes are shared by the objects loading the same file
+	std::shared_ptr<TriangleMesh> load_mesh(const std::string &file);
 };
 #endif 
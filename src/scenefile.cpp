@@ -0,0 +1,747 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#include "scene.h"
+#include "scenefile.h"
+#include "multijittered.h"
+#include "timeline.h"
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <map>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+//////////////////////////////////////////////////////////
+/// Helpers
+//////////////////////////////////////////////////////////
+
+static inline void to_array(float *a, const Point &p)
+{
+	a[0] = p.x;	a[1] = p.y;	a[2] = p.z;
+}
+
+static inline void to_array(float *a, const Vector &v)
+{
+	a[0] = v.x;	a[1] = v.y;	a[2] = v.z;
+}
+
+static inline void to_array(float *a, const Color &c)
+{
+	a[0] = c.r;	a[1] = c.g;	a[2] = c.b;
+}
+
+static inline void to_array(float *a, const BBox &b)
+{
+	to_array(a, b.min);
+	to_array(a + 3, b.max);
+}
+
+static inline Point to_point(const float *a)
+{
+	return Point(a[0], a[1], a[2]);
+}
+
+static inline BBox to_bbox(const float *a)
+{
+	return BBox(Point(a[0], a[1], a[2]), Point(a[3], a[4], a[5]));
+}
+
+// append a section of records, aligned to 8 bytes
+template<class T>
+static void write_section(std::ofstream &out, SceneFileHeader &header, SceneFileSection section, 
+	const std::vector<T> &records)
+{
+	uint64_t pos = (uint64_t)out.tellp();
+	while(pos % 8)
+	{
+		out.put(0);
+		++pos;
+	}
+	header.sections[section].offset = pos;
+	header.sections[section].count = records.size();
+	if(!records.empty())
+		out.write((const char*)&records[0], records.size() * sizeof(T));
+}
+
+// records of a section mapped in memory, NULL if they do not fit in the file
+template<class T>
+static const T *read_section(const MappedFile &file, const SceneFileHeader &header, SceneFileSection section)
+{
+	const SceneFileRange &range = header.sections[section];
+	if(range.offset > file.size() || range.offset % 8 ||
+		range.count > (file.size() - range.offset) / sizeof(T))
+		return NULL;
+	return (const T*)(file.data() + range.offset);
+}
+
+static void write_bvh(const BVH &bvh, std::vector<BVHNodeRecord> &nodes)
+{
+	for(size_t i = 0; i < bvh.nodes.size(); ++i)
+	{
+		const BVHNode &node = bvh.nodes[i];
+		BVHNodeRecord r;
+		to_array(r.bounds0, node.bounds0);
+		to_array(r.bounds1, node.bounds1);
+		r.offset = node.offset;
+		r.count = node.count;
+		r.axis = node.axis;
+		nodes.push_back(r);
+	}
+}
+
+// copy a hierarchy over num_prims primitives, false if its links are broken
+static bool read_bvh(BVH &bvh, const BVHNodeRecord *nodes, size_t num_nodes, 
+	const uint32_t *indices, size_t num_indices, size_t num_prims)
+{
+	bvh.nodes.resize(num_nodes);
+	// children always follow their parent, the depth must fit the
+	// traversal stack
+	std::vector<unsigned char> depth(num_nodes, 0);
+	for(size_t i = 0; i < num_nodes; ++i)
+	{
+		const BVHNodeRecord &r = nodes[i];
+		BVHNode &node = bvh.nodes[i];
+		node.bounds0 = to_bbox(r.bounds0);
+		node.bounds1 = to_bbox(r.bounds1);
+		node.offset = r.offset;
+		node.count = r.count;
+		node.axis = r.axis;
+		if(node.count > 0)
+		{
+			if((uint64_t)node.offset + node.count > num_indices)
+				return false;
+			continue;
+		}
+		if(node.offset <= i + 1 || node.offset >= num_nodes || node.axis < 0 || node.axis > 2 || depth[i] >= 60)
+			return false;
+		depth[i + 1] = std::max<unsigned char>(depth[i + 1], depth[i] + 1);
+		depth[node.offset] = std::max<unsigned char>(depth[node.offset], depth[i] + 1);
+	}
+	bvh.indices.assign(indices, indices + num_indices);
+	for(size_t i = 0; i < bvh.indices.size(); ++i)
+		if(bvh.indices[i] >= num_prims)
+			return false;
+	return true;
+}
+
+// a range of records inside a section with count records
+static inline bool in_section(const SceneFileRange &range, uint64_t count)
+{
+	return range.offset <= count && range.count <= count - range.offset;
+}
+
+//////////////////////////////////////////////////////////
+/// Compiled scene writer
+//////////////////////////////////////////////////////////
+
+bool Scene::save_binary(const char *file)
+{
+	TIMELINE_SCOPE("save compiled scene");
+	std::ofstream out(file, std::ios::binary);
+	if(!out.is_open())
+	{
+		std::cerr << "Failed to create compiled scene: " << file << std::endl;
+		return false;
+	}
+
+	SceneFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SCENE_FILE_MAGIC, 4);
+	header.version = SCENE_FILE_VERSION;
+	header.num_sections = SFS_Count;
+	header.bvh_time0 = static_bvh.time0;
+	header.bvh_time1 = static_bvh.time1;
+	// the header is written again at the end, with the sections filled
+	out.write((const char*)&header, sizeof(header));
+
+	std::vector<CameraRecord> cam(1);
+	to_array(cam[0].pos, camera.pos);
+	to_array(cam[0].lookat, camera.lookat);
+	to_array(cam[0].up, camera.up);
+	cam[0].fovy = camera.fovy;
+	cam[0].samples = screen.samples;
+	cam[0].lens_radius = camera.lens_radius;
+	cam[0].focal_length = camera.focal_length;
+	cam[0].shutter_time = camera.shutter_time;
+	cam[0].exposure = camera.exposure;
+	write_section(out, header, SFS_Camera, cam);
+
+	std::vector<LightRecord> lts;
+	for(size_t i = 0; i <= lights.size(); ++i)
+	{
+		const Light &light = i == 0 ? ambient : lights[i - 1];
+		LightRecord r;
+		to_array(r.pos, light.pos);
+		to_array(r.color, light.color);
+		r.att[0] = light.att.a;	r.att[1] = light.att.b;	r.att[2] = light.att.c;
+		r.type = light.type;
+		r.num_samples = light.num_samples;
+		r.area_size = light.area_size;
+		lts.push_back(r);
+	}
+	write_section(out, header, SFS_Lights, lts);
+
+	std::vector<char> strings;
+	std::vector<TextureRecord> texs;
+	for(size_t i = 0; i < textures.size(); ++i)
+	{
+		const Texture &tex = textures[i];
+		TextureRecord r;
+		memset(&r, 0, sizeof(r));
+		r.type = tex.type;
+		switch(tex.type)
+		{
+		case SolidTexture:
+			to_array(r.color1, tex.solid.color);
+			break;
+		case CheckerTexture:
+			to_array(r.color1, tex.checker.color1);
+			to_array(r.color2, tex.checker.color2);
+			r.scale = tex.checker.scale;
+			break;
+		case MapTexture:
+			to_array(r.p0, tex.map.p0);	r.p0[3] = tex.map.p0.w;
+			to_array(r.p1, tex.map.p1);	r.p1[3] = tex.map.p1.w;
+			// images are referenced by name and loaded with the scene
+			r.name_offset = strings.size();
+			r.name_length = tex.map.filename.size();
+			strings.insert(strings.end(), tex.map.filename.begin(), tex.map.filename.end());
+			break;
+		}
+		texs.push_back(r);
+	}
+	write_section(out, header, SFS_Textures, texs);
+
+	std::vector<MaterialRecord> mats;
+	for(size_t i = 0; i < materials.size(); ++i)
+	{
+		const Material &m = materials[i];
+		MaterialRecord r = { m.kA, m.kD, m.kS, m.alpha, m.kR, m.kT, m.ior };
+		mats.push_back(r);
+	}
+	write_section(out, header, SFS_Materials, mats);
+
+	std::map<const Object*, uint32_t> object_index;
+	std::map<const TriangleMesh*, uint32_t> mesh_index;
+	std::map<const ShapeGroup*, uint32_t> group_index;
+	std::vector<PlaneRecord> planes;
+	std::vector<MeshRecord> mesh_recs;
+	std::vector<float> positions, normals, uvs;
+	std::vector<uint32_t> triangles, mesh_indices;
+	std::vector<BVHNodeRecord> mesh_nodes;
+
+	// shape of an object or group member, meshes are written once,
+	// whatever the number of objects using them. The texture and material
+	// are left to the callers.
+	auto shape_record = [&](const Object *obj, ObjectRecord &r)
+	{
+		memset(&r, 0, sizeof(r));
+		r.type = obj->type;
+		r.id = obj->id;
+		to_array(r.pos, obj->original_pos);
+		to_array(r.rot, obj->original_rot);
+		to_array(r.scale, obj->original_scale);
+		to_array(r.acceleration, obj->acceleration);
+		switch(obj->type)
+		{
+		case Sphere:
+			r.params[0] = static_cast<const SphereObject*>(obj)->radius;
+			break;
+		case Torus:
+			r.params[0] = static_cast<const TorusObject*>(obj)->radius;
+			r.params[1] = static_cast<const TorusObject*>(obj)->thickness;
+			break;
+		case Cylinder:
+			r.params[0] = static_cast<const CylinderObject*>(obj)->bottom;
+			r.params[1] = static_cast<const CylinderObject*>(obj)->top;
+			r.params[2] = static_cast<const CylinderObject*>(obj)->radius;
+			break;
+		case Polyhedron:
+			{
+				const PolyhedronObject *poly = static_cast<const PolyhedronObject*>(obj);
+				r.first_plane = planes.size();
+				r.num_planes = poly->planes.size();
+				for(size_t j = 0; j < poly->planes.size(); ++j)
+				{
+					PlaneRecord p = { poly->planes[j].a, poly->planes[j].b, poly->planes[j].c, poly->planes[j].d };
+					planes.push_back(p);
+				}
+			}
+			break;
+		case Mesh:
+			{
+				const TriangleMesh *mesh = static_cast<const MeshObject*>(obj)->mesh.get();
+				auto it = mesh_index.find(mesh);
+				if(it == mesh_index.end())
+				{
+					it = mesh_index.insert(std::make_pair(mesh, (uint32_t)mesh_recs.size())).first;
+
+					MeshRecord m;
+					memset(&m, 0, sizeof(m));
+					m.name_offset = strings.size();
+					m.name_length = mesh->filename.size();
+					strings.insert(strings.end(), mesh->filename.begin(), mesh->filename.end());
+					m.vertices.offset = positions.size() / 3;
+					m.vertices.count = mesh->num_vertices();
+					m.has_normals = !mesh->normals.empty();
+					m.has_uvs = !mesh->uvs.empty();
+					positions.insert(positions.end(), mesh->positions.begin(), mesh->positions.end());
+					if(m.has_normals)
+						normals.insert(normals.end(), mesh->normals.begin(), mesh->normals.end());
+					else
+						normals.resize(positions.size(), 0.0f);
+					if(m.has_uvs)
+						uvs.insert(uvs.end(), mesh->uvs.begin(), mesh->uvs.end());
+					else
+						uvs.resize(2 * (positions.size() / 3), 0.0f);
+					m.triangles.offset = triangles.size() / 3;
+					m.triangles.count = mesh->num_triangles();
+					triangles.insert(triangles.end(), mesh->triangles.begin(), mesh->triangles.end());
+					m.nodes.offset = mesh_nodes.size();
+					m.nodes.count = mesh->bvh.nodes.size();
+					write_bvh(mesh->bvh, mesh_nodes);
+					m.indices.offset = mesh_indices.size();
+					m.indices.count = mesh->bvh.indices.size();
+					mesh_indices.insert(mesh_indices.end(), mesh->bvh.indices.begin(), mesh->bvh.indices.end());
+					mesh_recs.push_back(m);
+				}
+				r.geometry = it->second;
+			}
+			break;
+		case Instance:
+			r.geometry = group_index[static_cast<const InstanceObject*>(obj)->group.get()];
+			break;
+		}
+	};
+
+	// groups only refer to the ones before them
+	std::vector<GroupRecord> group_recs;
+	std::vector<ObjectRecord> group_shapes;
+	std::vector<BVHNodeRecord> group_nodes;
+	std::vector<uint32_t> group_indices, group_ids;
+	for(size_t i = 0; i < groups.size(); ++i)
+	{
+		const ShapeGroup &group = *groups[i];
+		group_index[&group] = i;
+
+		GroupRecord g;
+		g.shapes.offset = group_shapes.size();
+		g.shapes.count = group.shapes.size();
+		for(size_t j = 0; j < group.shapes.size(); ++j)
+		{
+			ObjectRecord r;
+			shape_record(group.shapes[j], r);
+			// group shapes are drawn with the texture and material of
+			// the instance, they have none of their own
+			r.texture = -1;
+			r.material = -1;
+			group_shapes.push_back(r);
+		}
+		g.nodes.offset = group_nodes.size();
+		g.nodes.count = group.bvh.nodes.size();
+		write_bvh(group.bvh, group_nodes);
+		g.indices.offset = group_indices.size();
+		g.indices.count = group.bvh.indices.size();
+		group_indices.insert(group_indices.end(), group.bvh.indices.begin(), group.bvh.indices.end());
+		g.bvh_shapes.offset = group_ids.size();
+		g.bvh_shapes.count = group.bvh_shapes.size();
+		group_ids.insert(group_ids.end(), group.bvh_shapes.begin(), group.bvh_shapes.end());
+		g.unbounded.offset = group_ids.size();
+		g.unbounded.count = group.unbounded.size();
+		group_ids.insert(group_ids.end(), group.unbounded.begin(), group.unbounded.end());
+		group_recs.push_back(g);
+	}
+
+	std::vector<ObjectRecord> objs;
+	for(size_t i = 0; i < objects.size(); ++i)
+	{
+		object_index[objects[i]] = i;
+		ObjectRecord r;
+		shape_record(objects[i], r);
+		r.texture = objects[i]->texture ? objects[i]->texture->id : -1;
+		r.material = objects[i]->material.id;
+		objs.push_back(r);
+	}
+	write_section(out, header, SFS_Objects, objs);
+	write_section(out, header, SFS_Planes, planes);
+	write_section(out, header, SFS_Strings, strings);
+
+	std::vector<BVHNodeRecord> nodes;
+	write_bvh(static_bvh, nodes);
+	write_section(out, header, SFS_BVHNodes, nodes);
+	write_section(out, header, SFS_BVHIndices, static_bvh.indices);
+
+	std::vector<uint32_t> ids;
+	for(size_t i = 0; i < static_bvh_objects.size(); ++i)
+		ids.push_back(object_index[static_bvh_objects[i]]);
+	write_section(out, header, SFS_BVHObjects, ids);
+
+	// the moving objects are placed again when the file is loaded
+	ids.clear();
+	for(size_t i = 0; i < unbounded_objects.size(); ++i)
+		if(unbounded_objects[i]->is_static())
+			ids.push_back(object_index[unbounded_objects[i]]);
+	write_section(out, header, SFS_Unbounded, ids);
+
+	write_section(out, header, SFS_Meshes, mesh_recs);
+	write_section(out, header, SFS_MeshPositions, positions);
+	write_section(out, header, SFS_MeshNormals, normals);
+	write_section(out, header, SFS_MeshUVs, uvs);
+	write_section(out, header, SFS_MeshTriangles, triangles);
+	write_section(out, header, SFS_MeshBVHNodes, mesh_nodes);
+	write_section(out, header, SFS_MeshBVHIndices, mesh_indices);
+
+	write_section(out, header, SFS_Groups, group_recs);
+	write_section(out, header, SFS_GroupShapes, group_shapes);
+	write_section(out, header, SFS_GroupBVHNodes, group_nodes);
+	write_section(out, header, SFS_GroupBVHIndices, group_indices);
+	write_section(out, header, SFS_GroupShapeIds, group_ids);
+
+	out.seekp(0);
+	out.write((const char*)&header, sizeof(header));
+	if(!out.good())
+	{
+		std::cerr << "Failed to write compiled scene: " << file << std::endl;
+		return false;
+	}
+	return true;
+}
+
+//////////////////////////////////////////////////////////
+/// Compiled scene reader
+//////////////////////////////////////////////////////////
+
+bool Scene::load_binary(const MappedFile &file)
+{
+	TIMELINE_SCOPE("load compiled scene");
+	if(file.size() < sizeof(SceneFileHeader))
+		return false;
+
+	SceneFileHeader header;
+	memcpy(&header, file.data(), sizeof(header));
+	if(header.version != SCENE_FILE_VERSION || header.num_sections != SFS_Count)
+	{
+		std::cerr << "Unsupported compiled scene version " << header.version 
+			<< " (expected " << SCENE_FILE_VERSION << "), compile it again." << std::endl;
+		return false;
+	}
+
+	const CameraRecord *cam = read_section<CameraRecord>(file, header, SFS_Camera);
+	const LightRecord *lts = read_section<LightRecord>(file, header, SFS_Lights);
+	const TextureRecord *texs = read_section<TextureRecord>(file, header, SFS_Textures);
+	const MaterialRecord *mats = read_section<MaterialRecord>(file, header, SFS_Materials);
+	const ObjectRecord *objs = read_section<ObjectRecord>(file, header, SFS_Objects);
+	const PlaneRecord *planes = read_section<PlaneRecord>(file, header, SFS_Planes);
+	const char *strings = read_section<char>(file, header, SFS_Strings);
+	const BVHNodeRecord *nodes = read_section<BVHNodeRecord>(file, header, SFS_BVHNodes);
+	const uint32_t *indices = read_section<uint32_t>(file, header, SFS_BVHIndices);
+	const uint32_t *bvh_ids = read_section<uint32_t>(file, header, SFS_BVHObjects);
+	const uint32_t *unbounded_ids = read_section<uint32_t>(file, header, SFS_Unbounded);
+	const MeshRecord *mesh_recs = read_section<MeshRecord>(file, header, SFS_Meshes);
+	const float *positions = read_section<float>(file, header, SFS_MeshPositions);
+	const float *normals = read_section<float>(file, header, SFS_MeshNormals);
+	const float *uvs = read_section<float>(file, header, SFS_MeshUVs);
+	const uint32_t *triangles = read_section<uint32_t>(file, header, SFS_MeshTriangles);
+	const BVHNodeRecord *mesh_nodes = read_section<BVHNodeRecord>(file, header, SFS_MeshBVHNodes);
+	const uint32_t *mesh_indices = read_section<uint32_t>(file, header, SFS_MeshBVHIndices);
+	const GroupRecord *group_recs = read_section<GroupRecord>(file, header, SFS_Groups);
+	const ObjectRecord *group_shapes = read_section<ObjectRecord>(file, header, SFS_GroupShapes);
+	const BVHNodeRecord *group_nodes = read_section<BVHNodeRecord>(file, header, SFS_GroupBVHNodes);
+	const uint32_t *group_indices = read_section<uint32_t>(file, header, SFS_GroupBVHIndices);
+	const uint32_t *group_ids = read_section<uint32_t>(file, header, SFS_GroupShapeIds);
+	if(!cam || !lts || !texs || !mats || !objs || !planes || !strings || 
+		!nodes || !indices || !bvh_ids || !unbounded_ids || !mesh_recs || !positions ||
+		!normals || !uvs || !triangles || !mesh_nodes || !mesh_indices || !group_recs || 
+		!group_shapes || !group_nodes || !group_indices || !group_ids ||
+		header.sections[SFS_Camera].count != 1 || header.sections[SFS_Lights].count < 1)
+		return false;
+
+	// camera
+	camera.pos = to_point(cam->pos);
+	camera.lookat = to_point(cam->lookat);
+	camera.up = Vector(cam->up[0], cam->up[1], cam->up[2]);
+	camera.fovy = cam->fovy;
+	screen.samples = cam->samples;
+	camera.lens_radius = cam->lens_radius;
+	camera.focal_length = cam->focal_length;
+	camera.shutter_time = cam->shutter_time;
+	camera.exposure = cam->exposure;
+	setup_camera();
+
+	// lights, the first one is the ambient
+	numLights = header.sections[SFS_Lights].count;
+	for(size_t i = 0; i < numLights; ++i)
+	{
+		const LightRecord &r = lts[i];
+		Light light;
+		light.pos = to_point(r.pos);
+		light.color = Color(r.color[0], r.color[1], r.color[2]);
+		light.att.a = r.att[0];	light.att.b = r.att[1];	light.att.c = r.att[2];
+		if(i == 0)
+		{
+			ambient = light;
+			continue;
+		}
+		light.num_samples = r.num_samples;
+		light.area_size = r.area_size;
+		light.id = lights.size();
+		light.build_area((LightAreaType)r.type);
+		lights.push_back(light);
+	}
+
+	// textures
+	numTextures = header.sections[SFS_Textures].count;
+	for(size_t i = 0; i < numTextures; ++i)
+	{
+		const TextureRecord &r = texs[i];
+		Texture tex;
+		tex.id = i;
+		tex.type = (TextureType)r.type;
+		switch(tex.type)
+		{
+		case SolidTexture:
+			tex.solid.color = Color(r.color1[0], r.color1[1], r.color1[2]);
+			break;
+		case CheckerTexture:
+			tex.checker.color1 = Color(r.color1[0], r.color1[1], r.color1[2]);
+			tex.checker.color2 = Color(r.color2[0], r.color2[1], r.color2[2]);
+			tex.checker.scale = r.scale;
+			tex.checker.map[0][0] = tex.checker.color1;
+			tex.checker.map[0][1] = tex.checker.color2;
+			tex.checker.map[1][0] = tex.checker.color1;
+			tex.checker.map[1][1] = tex.checker.color2;
+			break;
+		case MapTexture:
+			if((uint64_t)r.name_offset + r.name_length > header.sections[SFS_Strings].count)
+				return false;
+			tex.map.filename.assign(strings + r.name_offset, r.name_length);
+			tex.map.p0 = Point(r.p0[0], r.p0[1], r.p0[2], r.p0[3]);
+			tex.map.p1 = Point(r.p1[0], r.p1[1], r.p1[2], r.p1[3]);
+			try
+			{
+				tex.map.mip.load(tex.map.filename);
+			}
+			catch(const std::runtime_error &e)
+			{
+				std::cerr << "Failed to load texture " << tex.map.filename << ": " << e.what() << std::endl;
+				return false;
+			}
+			break;
+		default:
+			return false;
+		}
+		textures.push_back(tex);
+	}
+
+	// materials
+	numMaterials = header.sections[SFS_Materials].count;
+	for(size_t i = 0; i < numMaterials; ++i)
+	{
+		const MaterialRecord &r = mats[i];
+		Material material;
+		material.id = i;
+		material.kA = r.kA;	material.kD = r.kD;	material.kS = r.kS;	material.alpha = r.alpha;
+		material.kR = r.kR;	material.kT = r.kT;	material.ior = r.ior;
+		materials.push_back(material);
+	}
+
+	// meshes
+	size_t num_vertices = header.sections[SFS_MeshPositions].count / 3;
+	if(header.sections[SFS_MeshNormals].count != 3 * num_vertices || 
+		header.sections[SFS_MeshUVs].count != 2 * num_vertices)
+		return false;
+	std::vector<std::shared_ptr<TriangleMesh> > mesh_list;
+	for(size_t i = 0; i < header.sections[SFS_Meshes].count; ++i)
+	{
+		const MeshRecord &r = mesh_recs[i];
+		if((uint64_t)r.name_offset + r.name_length > header.sections[SFS_Strings].count ||
+			!in_section(r.vertices, num_vertices) ||
+			!in_section(r.triangles, header.sections[SFS_MeshTriangles].count / 3) ||
+			!in_section(r.nodes, header.sections[SFS_MeshBVHNodes].count) ||
+			!in_section(r.indices, header.sections[SFS_MeshBVHIndices].count))
+			return false;
+
+		std::shared_ptr<TriangleMesh> mesh = std::make_shared<TriangleMesh>();
+		mesh->filename.assign(strings + r.name_offset, r.name_length);
+		mesh->positions.assign(positions + 3 * r.vertices.offset, positions + 3 * (r.vertices.offset + r.vertices.count));
+		if(r.has_normals)
+			mesh->normals.assign(normals + 3 * r.vertices.offset, normals + 3 * (r.vertices.offset + r.vertices.count));
+		if(r.has_uvs)
+			mesh->uvs.assign(uvs + 2 * r.vertices.offset, uvs + 2 * (r.vertices.offset + r.vertices.count));
+		mesh->triangles.assign(triangles + 3 * r.triangles.offset, triangles + 3 * (r.triangles.offset + r.triangles.count));
+		for(size_t j = 0; j < mesh->triangles.size(); ++j)
+			if(mesh->triangles[j] >= r.vertices.count)
+				return false;
+		if(r.nodes.count == 0 || !read_bvh(mesh->bvh, mesh_nodes + r.nodes.offset, r.nodes.count, 
+			mesh_indices + r.indices.offset, r.indices.count, r.triangles.count))
+			return false;
+		mesh_list.push_back(mesh);
+	}
+
+	// shape of an object or group member, NULL if the record is invalid
+	auto make_shape = [&](const ObjectRecord &r, Arena &arena) -> Object*
+	{
+		Object *object;
+		switch(r.type)
+		{
+		case Sphere:
+			{
+				SphereObject *sphere = arena.create<SphereObject>();
+				sphere->radius = r.params[0];
+				object = sphere;
+			}
+			break;
+		case Torus:
+			{
+				TorusObject *torus = arena.create<TorusObject>();
+				torus->radius = r.params[0];
+				torus->thickness = r.params[1];
+				object = torus;
+			}
+			break;
+		case Cylinder:
+			{
+				CylinderObject *cylinder = arena.create<CylinderObject>();
+				cylinder->bottom = r.params[0];
+				cylinder->top = r.params[1];
+				cylinder->radius = r.params[2];
+				object = cylinder;
+			}
+			break;
+		case Polyhedron:
+			{
+				if((uint64_t)r.first_plane + r.num_planes > header.sections[SFS_Planes].count)
+					return NULL;
+				PolyhedronObject *poly = arena.create<PolyhedronObject>();
+				poly->numFaces = r.num_planes;
+				for(uint32_t j = 0; j < r.num_planes; ++j)
+				{
+					const PlaneRecord &p = planes[r.first_plane + j];
+					poly->planes.push_back(Plane(p.a, p.b, p.c, p.d));
+				}
+				poly->build();
+				object = poly;
+			}
+			break;
+		case Mesh:
+			{
+				if(r.geometry >= mesh_list.size())
+					return NULL;
+				MeshObject *mesh = arena.create<MeshObject>();
+				mesh->mesh = mesh_list[r.geometry];
+				object = mesh;
+			}
+			break;
+		case Instance:
+			{
+				// groups only refer to the ones already read
+				if(r.geometry >= groups.size())
+					return NULL;
+				InstanceObject *instance = arena.create<InstanceObject>();
+				instance->group = groups[r.geometry];
+				object = instance;
+			}
+			break;
+		default:
+			return NULL;
+		}
+
+		object->id = r.id;
+		object->original_pos = to_point(r.pos);
+		object->original_rot = to_point(r.rot);
+		object->original_scale = to_point(r.scale);
+		object->acceleration = Vector(r.acceleration[0], r.acceleration[1], r.acceleration[2]);
+		object->calculate_matrices();
+		return object;
+	};
+
+	// shape groups
+	for(size_t i = 0; i < header.sections[SFS_Groups].count; ++i)
+	{
+		const GroupRecord &g = group_recs[i];
+		uint64_t num_ids = header.sections[SFS_GroupShapeIds].count;
+		if(!in_section(g.shapes, header.sections[SFS_GroupShapes].count) ||
+			!in_section(g.nodes, header.sections[SFS_GroupBVHNodes].count) ||
+			!in_section(g.indices, header.sections[SFS_GroupBVHIndices].count) ||
+			!in_section(g.bvh_shapes, num_ids) || !in_section(g.unbounded, num_ids))
+			return false;
+
+		std::shared_ptr<ShapeGroup> group = std::make_shared<ShapeGroup>();
+		group->id = i;
+		for(uint64_t j = 0; j < g.shapes.count; ++j)
+		{
+			Object *shape = make_shape(group_shapes[g.shapes.offset + j], group->arena);
+			if(!shape || !shape->is_static())
+				return false;
+			group->shapes.push_back(shape);
+		}
+		group->bvh_shapes.assign(group_ids + g.bvh_shapes.offset, group_ids + g.bvh_shapes.offset + g.bvh_shapes.count);
+		group->unbounded.assign(group_ids + g.unbounded.offset, group_ids + g.unbounded.offset + g.unbounded.count);
+		for(size_t j = 0; j < group->bvh_shapes.size(); ++j)
+			if(group->bvh_shapes[j] >= g.shapes.count)
+				return false;
+		for(size_t j = 0; j < group->unbounded.size(); ++j)
+			if(group->unbounded[j] >= g.shapes.count)
+				return false;
+		if(g.nodes.count > 0 && !read_bvh(group->bvh, group_nodes + g.nodes.offset, g.nodes.count,
+			group_indices + g.indices.offset, g.indices.count, g.bvh_shapes.count))
+			return false;
+		groups.push_back(group);
+	}
+
+	// objects
+	numObjects = header.sections[SFS_Objects].count;
+	objects.reserve(numObjects);
+	for(size_t i = 0; i < numObjects; ++i)
+	{
+		const ObjectRecord &r = objs[i];
+		if(r.texture < 0 || (size_t)r.texture >= textures.size() ||
+			r.material < 0 || (size_t)r.material >= materials.size())
+			return false;
+
+		Object *object = make_shape(r, object_arena);
+		if(!object)
+			return false;
+		object->texture = &textures[r.texture];
+		object->material = materials[r.material];
+		objects.push_back(object);
+		if(!object->is_static())
+			dynamic_objects.push_back(object);
+	}
+
+	// prebuilt bvh of the static objects
+	size_t num_prims = header.sections[SFS_BVHObjects].count;
+	if(!read_bvh(static_bvh, nodes, header.sections[SFS_BVHNodes].count, 
+		indices, header.sections[SFS_BVHIndices].count, num_prims))
+		return false;
+	static_bvh.set_time_range(header.bvh_time0, header.bvh_time1);
+
+	for(size_t i = 0; i < num_prims; ++i)
+	{
+		if(bvh_ids[i] >= objects.size())
+			return false;
+		static_bvh_objects.push_back(objects[bvh_ids[i]]);
+	}
+	for(size_t i = 0; i < header.sections[SFS_Unbounded].count; ++i)
+	{
+		if(unbounded_ids[i] >= objects.size())
+			return false;
+		unbounded_objects.push_back(objects[unbounded_ids[i]]);
+	}
+	return true;
+}
@@ -0,0 +1,170 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#ifndef SCENEFILE_H
+#define SCENEFILE_H
+
+#include <stdint.h>
+
+// Compiled scene format. The file starts with a header holding the
+// position of every section, each section is a flat array of records
+// aligned to 8 bytes. Record fields are aligned to their size, so the
+// file can be read in place.
+
+#define SCENE_FILE_MAGIC "RTSC"
+#define SCENE_FILE_VERSION 5
+
+// Sections of the file, in the order they are written.
+enum SceneFileSection
+{
+	SFS_Camera,		// one CameraRecord
+	SFS_Lights,		// LightRecord, the first one is the ambient light
+	SFS_Textures,	// TextureRecord
+	SFS_Materials,	// MaterialRecord
+	SFS_Objects,	// ObjectRecord
+	SFS_Planes,		// PlaneRecord, referenced by polyhedra
+	SFS_Strings,	// chars, texture file names
+	SFS_BVHNodes,	// BVHNodeRecord
+	SFS_BVHIndices,	// uint32_t, primitive indices of the bvh leaves
+	SFS_BVHObjects,	// uint32_t, object index of every bvh primitive
+	SFS_Unbounded,	// uint32_t, objects tested outside the bvh
+	SFS_Meshes,		// MeshRecord, shared by the mesh objects
+	SFS_MeshPositions,	// float, xyz per vertex
+	SFS_MeshNormals,	// float, xyz per vertex
+	SFS_MeshUVs,		// float, uv per vertex
+	SFS_MeshTriangles,	// uint32_t, three vertex indices per triangle
+	SFS_MeshBVHNodes,	// BVHNodeRecord
+	SFS_MeshBVHIndices,	// uint32_t
+	SFS_Groups,			// GroupRecord
+	SFS_GroupShapes,	// ObjectRecord, shapes of the groups
+	SFS_GroupBVHNodes,	// BVHNodeRecord
+	SFS_GroupBVHIndices,	// uint32_t
+	SFS_GroupShapeIds,	// uint32_t, shape of every group bvh primitive and unbounded shapes
+	SFS_Count
+};
+
+struct SceneFileRange
+{
+	uint64_t offset;	// from the start of the file
+	uint64_t count;		// number of records
+};
+
+struct SceneFileHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t num_sections;
+	float bvh_time0;	// shutter interval of the static bvh bounds
+	float bvh_time1;
+	uint32_t reserved;
+	SceneFileRange sections[SFS_Count];
+};
+
+struct CameraRecord
+{
+	float pos[3];
+	float lookat[3];
+	float up[3];
+	float fovy;
+	int32_t samples;
+	float lens_radius;
+	float focal_length;
+	float shutter_time;
+	float exposure;
+};
+
+struct LightRecord
+{
+	float pos[3];
+	float color[3];
+	float att[3];
+	int32_t type;		// LightAreaType
+	int32_t num_samples;
+	float area_size;
+};
+
+struct TextureRecord
+{
+	int32_t type;		// TextureType
+	float color1[3];	// solid color or first checker color
+	float color2[3];
+	float scale;
+	float p0[4];
+	float p1[4];
+	uint32_t name_offset;	// texture map file name, in the strings section
+	uint32_t name_length;
+};
+
+struct MaterialRecord
+{
+	float kA, kD, kS, alpha, kR, kT, ior;
+};
+
+struct ObjectRecord
+{
+	int32_t type;		// ObjectType
+	int32_t id;
+	int32_t texture;
+	int32_t material;
+	float pos[3];
+	float rot[3];
+	float scale[3];
+	float acceleration[3];
+	float params[3];	// sphere: radius, torus: radius thickness, cylinder: bottom top radius
+	uint32_t first_plane;
+	uint32_t num_planes;
+	uint32_t geometry;	// mesh: index in the meshes section, instance: in the groups section
+};
+
+struct PlaneRecord
+{
+	float a, b, c, d;
+};
+
+// Mesh data, positions, normals and uvs are counted in vertices and
+// the bvh leaves refer to the mesh triangles.
+struct MeshRecord
+{
+	uint32_t name_offset;	// OBJ file name, in the strings section
+	uint32_t name_length;
+	SceneFileRange vertices;	// normals and uvs use the same range when present
+	uint32_t has_normals;
+	uint32_t has_uvs;
+	SceneFileRange triangles;
+	SceneFileRange nodes;
+	SceneFileRange indices;
+};
+
+// Shape group, the shapes have no texture nor material (-1).
+struct GroupRecord
+{
+	SceneFileRange shapes;
+	SceneFileRange nodes;
+	SceneFileRange indices;
+	SceneFileRange bvh_shapes;	// in the group shape ids section
+	SceneFileRange unbounded;	// in the group shape ids section
+};
+
+struct BVHNodeRecord
+{
+	float bounds0[6];	// min xyz, max xyz
+	float bounds1[6];
+	uint32_t offset;
+	uint32_t count;
+	int32_t axis;
+};
+
+#endif
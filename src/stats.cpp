@@ -0,0 +1,76 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#include "stats.h"
+#include <cstring>
+
+static const char *object_type_names[STATS_OBJECT_TYPES] = { "sphere", "polyhedron", "torus", "cylinder", "mesh", "instance" };
+
+RenderStats::RenderStats()
+{
+	memset(this, 0, sizeof(*this));
+}
+
+double RenderStats::average_depth() const
+{
+	size_t calls = 0, levels = 0;
+	for(int i = 0; i < STATS_MAX_DEPTH; ++i)
+	{
+		calls += traces[i];
+		levels += traces[i] * i;
+	}
+	return calls ? (double)levels / calls : 0;
+}
+
+void RenderStats::print(std::ostream &out) const
+{
+	size_t calls = 0;
+	for(int i = 0; i < STATS_MAX_DEPTH; ++i)
+		calls += traces[i];
+	out << "rays: " << rays.total() << ", camera: " << rays.camera << ", shadow: " << rays.shadow 
+		<< ", reflection: " << rays.reflection << ", refraction: " << rays.refraction << std::endl;
+	out << "trace calls: " << calls << ", missed: " << trace_misses 
+		<< ", average depth: " << average_depth() << ", total internal reflections: " << internal_reflections << std::endl;
+	out << "trace calls by depth:";
+	for(int i = 0; i < STATS_MAX_DEPTH; ++i)
+		if(traces[i])
+			out << " " << i << ":" << traces[i];
+	out << std::endl;
+	for(int i = 0; i < STATS_OBJECT_TYPES; ++i)
+		if(hit_tests[i])
+			out << object_type_names[i] << " hit tests: " << hit_tests[i] << ", hits: " << hits[i] 
+				<< " (" << (100.0 * hits[i]) / hit_tests[i] << "%)" << std::endl;
+}
+
+void RenderStats::write_json(std::ostream &out, const char *indent) const
+{
+	out << "{\n" << indent << "  \"rays\": { \"camera\": " << rays.camera << ", \"shadow\": " << rays.shadow 
+		<< ", \"reflection\": " << rays.reflection << ", \"refraction\": " << rays.refraction 
+		<< ", \"total\": " << rays.total() << " },\n";
+	out << indent << "  \"hit_tests\": {";
+	for(int i = 0; i < STATS_OBJECT_TYPES; ++i)
+		out << (i ? ", " : " ") << "\"" << object_type_names[i] << "\": " << hit_tests[i];
+	out << " },\n" << indent << "  \"hits\": {";
+	for(int i = 0; i < STATS_OBJECT_TYPES; ++i)
+		out << (i ? ", " : " ") << "\"" << object_type_names[i] << "\": " << hits[i];
+	out << " },\n" << indent << "  \"traces_by_depth\": [";
+	for(int i = 0; i < STATS_MAX_DEPTH; ++i)
+		out << (i ? ", " : "") << traces[i];
+	out << "],\n" << indent << "  \"trace_misses\": " << trace_misses << ",\n"
+		<< indent << "  \"average_depth\": " << average_depth() << ",\n"
+		<< indent << "  \"internal_reflections\": " << internal_reflections << "\n"
+		<< indent << "}";
+}
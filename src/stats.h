@@ -0,0 +1,66 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#ifndef STATS_H
+#define STATS_H
+
+#include <cstddef>
+#include <ostream>
+#include "object.h"
+
+// The counters are only kept when built with RAYTRACER_STATS defined
+// (-DRAYTRACER_STATS), otherwise STAT leaves no code behind.
+#ifdef RAYTRACER_STATS
+#define STAT(x) x
+#else
+#define STAT(x)
+#endif
+
+#define STATS_OBJECT_TYPES (Instance + 1)
+// recursion levels counted one by one, deeper ones share the last slot
+#define STATS_MAX_DEPTH 16
+
+// rays traced by a compute call, by type
+struct RayCounts
+{
+	size_t camera;
+	size_t shadow;
+	size_t reflection;
+	size_t refraction;
+
+	inline size_t total() const { return camera + shadow + reflection + refraction; }
+};
+
+// Where the rays of a render went. Every Raytracer keeps its own, reset
+// by every compute call.
+struct RenderStats
+{
+	RenderStats();
+
+	RayCounts rays;							// traced, by type
+	size_t hit_tests[STATS_OBJECT_TYPES];	// by object type
+	size_t hits[STATS_OBJECT_TYPES];
+	size_t traces[STATS_MAX_DEPTH];			// trace calls by recursion level
+	size_t trace_misses;					// trace calls that found nothing
+	size_t internal_reflections;			// total internal reflections
+
+	double average_depth() const;
+
+	void print(std::ostream &out) const;
+	void write_json(std::ostream &out, const char *indent) const;
+};
+
+#endif
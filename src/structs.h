@@ -20,7 +20,7 @@
 #include "math/vector.h"
 #include "math/point.h"
 #include "color.h"
-#include "ppmimage.h"
+#include "mipmap.h"
 
 // Structs for Raytracing task
 
@@ -40,6 +40,7 @@ struct Camera
 	
 	Sampler* sampler;
 	float focal_dist;
+	float focal_length;	// focal distance as given in the scene file
 	float lens_radius;
 };
 
@@ -82,7 +83,7 @@ struct MapTextureData
     std::string filename;
     Point p0;
     Point p1;
-    PPMImage image;
+    MipMap mip;	// the image and its smaller levels
 };
 
 // texture.
@@ -0,0 +1,319 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#include "tiledframebuffer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+bool FramebufferSettings::parse_storage(const std::string &name, TileStorage &storage)
+{
+	if(name == "half")
+		storage = HalfStorage;
+	else if(name == "rgb9e5")
+		storage = SharedExponentStorage;
+	else
+		return false;
+	return true;
+}
+
+TiledFramebuffer::TiledFramebuffer()
+	: width_px(0), height_px(0), tiles_x(0), tiles_y(0), storage(HalfStorage), pixel_bytes(0), tile_bytes(0), 
+	head(-1), tail(-1), used(0), last(-1), loads(0), stores(0)
+{
+}
+
+bool TiledFramebuffer::create(size_t w, size_t h, const FramebufferSettings &settings, const std::string &file)
+{
+	close();
+	width_px = w;
+	height_px = h;
+	tiles_x = (w + FRAMEBUFFER_TILE_SIZE - 1) / FRAMEBUFFER_TILE_SIZE;
+	tiles_y = (h + FRAMEBUFFER_TILE_SIZE - 1) / FRAMEBUFFER_TILE_SIZE;
+	storage = settings.storage;
+	pixel_bytes = storage == HalfStorage ? 3 * sizeof(uint16_t) : sizeof(uint32_t);
+	// 6 or 4 bytes a pixel keeps every tile on a page boundary
+	tile_bytes = pixel_bytes * FRAMEBUFFER_TILE_SIZE * FRAMEBUFFER_TILE_SIZE;
+
+	size_t tiles = tiles_x * tiles_y;
+	if(!scratch.create(file, tiles * tile_bytes))
+	{
+		std::cerr << "Failed to create framebuffer scratch file: " << file << std::endl;
+		return false;
+	}
+
+	const size_t tile_floats = FRAMEBUFFER_TILE_SIZE * FRAMEBUFFER_TILE_SIZE;
+	size_t cached = settings.cache_mb * 1024 * 1024 / (tile_floats * sizeof(Color));
+	// scanline rendering goes through a whole row of tiles before coming
+	// back to the first one, fewer slots would miss on every pixel row
+	cached = std::min(std::max(cached, tiles_x + 1), tiles);
+	cache.assign(cached * tile_floats, Color());
+	slots.assign(cached, Slot());
+	tile_slot.assign(tiles, -1);
+	stored.assign(tiles, false);
+	head = tail = last = -1;
+	used = 0;
+	loads = stores = 0;
+	return true;
+}
+
+void TiledFramebuffer::close()
+{
+	scratch.close();
+	std::vector<Color>().swap(cache);
+	slots.clear();
+	tile_slot.clear();
+	stored.clear();
+	head = tail = last = -1;
+	used = 0;
+}
+
+void TiledFramebuffer::unlink_slot(int s)
+{
+	Slot &slot = slots[s];
+	if(slot.prev >= 0)
+		slots[slot.prev].next = slot.next;
+	else
+		head = slot.next;
+	if(slot.next >= 0)
+		slots[slot.next].prev = slot.prev;
+	else
+		tail = slot.prev;
+}
+
+void TiledFramebuffer::push_front(int s)
+{
+	slots[s].prev = -1;
+	slots[s].next = head;
+	if(head >= 0)
+		slots[head].prev = s;
+	head = s;
+	if(tail < 0)
+		tail = s;
+}
+
+int TiledFramebuffer::fetch(size_t tile)
+{
+	int s = tile_slot[tile];
+	if(s >= 0)
+	{
+		// hit, becomes the most recently used
+		if(s != head)
+		{
+			unlink_slot(s);
+			push_front(s);
+		}
+		return last = s;
+	}
+
+	if(used < (int)slots.size())
+		s = used++;
+	else
+	{
+		// the least recently used slot goes back to the file
+		s = tail;
+		store(s);
+		tile_slot[slots[s].tile] = -1;
+		unlink_slot(s);
+	}
+	slots[s].tile = tile;
+	slots[s].dirty = false;
+	tile_slot[tile] = s;
+	load(s);
+	push_front(s);
+	return last = s;
+}
+
+void TiledFramebuffer::store(int s)
+{
+	Slot &slot = slots[s];
+	if(!slot.dirty)
+		return;
+	const Color *src = &cache[(size_t)s * FRAMEBUFFER_TILE_SIZE * FRAMEBUFFER_TILE_SIZE];
+	char *dst = scratch.writable_data() + slot.tile * tile_bytes;
+	for(size_t i = 0; i < FRAMEBUFFER_TILE_SIZE * FRAMEBUFFER_TILE_SIZE; ++i)
+		encode(src[i], dst + i * pixel_bytes);
+	// the encoded tile only needs to be in the file
+	scratch.release(slot.tile * tile_bytes, tile_bytes);
+	stored[slot.tile] = true;
+	slot.dirty = false;
+	++stores;
+}
+
+void TiledFramebuffer::load(int s)
+{
+	Color *dst = &cache[(size_t)s * FRAMEBUFFER_TILE_SIZE * FRAMEBUFFER_TILE_SIZE];
+	size_t tile = slots[s].tile;
+	if(!stored[tile])
+	{
+		std::fill(dst, dst + FRAMEBUFFER_TILE_SIZE * FRAMEBUFFER_TILE_SIZE, Color());
+		return;
+	}
+	const char *src = scratch.data() + tile * tile_bytes;
+	for(size_t i = 0; i < FRAMEBUFFER_TILE_SIZE * FRAMEBUFFER_TILE_SIZE; ++i)
+		dst[i] = decode(src + i * pixel_bytes);
+	scratch.release(tile * tile_bytes, tile_bytes);
+	++loads;
+}
+
+void TiledFramebuffer::flush()
+{
+	for(int s = head; s >= 0; s = slots[s].next)
+		store(s);
+}
+
+void TiledFramebuffer::read_row(size_t h, Color *row)
+{
+	size_t ty = h / FRAMEBUFFER_TILE_SIZE, y = h % FRAMEBUFFER_TILE_SIZE;
+	for(size_t tx = 0; tx < tiles_x; ++tx)
+	{
+		size_t tile = ty * tiles_x + tx;
+		size_t x0 = tx * FRAMEBUFFER_TILE_SIZE;
+		size_t n = std::min<size_t>(FRAMEBUFFER_TILE_SIZE, width_px - x0);
+		if(!stored[tile])
+		{
+			std::fill(row + x0, row + x0 + n, Color());
+			continue;
+		}
+		const char *src = scratch.data() + tile * tile_bytes + y * FRAMEBUFFER_TILE_SIZE * pixel_bytes;
+		for(size_t x = 0; x < n; ++x)
+			row[x0 + x] = decode(src + x * pixel_bytes);
+	}
+	// last row of a band of tiles
+	if(y == FRAMEBUFFER_TILE_SIZE - 1 || h + 1 == height_px)
+		scratch.release(ty * tiles_x * tile_bytes, tiles_x * tile_bytes);
+}
+
+void TiledFramebuffer::print(std::ostream &out) const
+{
+	out << "Framebuffer: " << tiles_x * tiles_y << " tiles of " << FRAMEBUFFER_TILE_SIZE << "x" << FRAMEBUFFER_TILE_SIZE 
+		<< " (" << (storage == HalfStorage ? "half" : "rgb9e5") << "), " << slots.size() << " cached, " 
+		<< loads << " loaded, " << stores << " written back" << std::endl;
+}
+
+void TiledFramebuffer::encode(const Color &c, char *dst) const
+{
+	if(storage == HalfStorage)
+	{
+		uint16_t v[3] = {float_to_half(c.r), float_to_half(c.g), float_to_half(c.b)};
+		memcpy(dst, v, sizeof(v));
+	}
+	else
+	{
+		uint32_t v = color_to_rgb9e5(c);
+		memcpy(dst, &v, sizeof(v));
+	}
+}
+
+Color TiledFramebuffer::decode(const char *src) const
+{
+	if(storage == HalfStorage)
+	{
+		uint16_t v[3];
+		memcpy(v, src, sizeof(v));
+		return Color(half_to_float(v[0]), half_to_float(v[1]), half_to_float(v[2]));
+	}
+	uint32_t v;
+	memcpy(&v, src, sizeof(v));
+	return rgb9e5_to_color(v);
+}
+
+uint16_t TiledFramebuffer::float_to_half(float f)
+{
+	uint32_t x;
+	memcpy(&x, &f, sizeof(x));
+	uint32_t sign = (x >> 16) & 0x8000;
+	uint32_t bits = (x >> 23) & 0xff;
+	uint32_t mantissa = x & 0x7fffff;
+	// infinity and nan
+	if(bits == 0xff)
+		return (uint16_t)(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+	int exponent = (int)bits - 127 + 15;
+	if(exponent >= 31)
+		return (uint16_t)(sign | 0x7c00);
+	if(exponent <= 0)
+	{
+		// subnormal half, or zero
+		if(exponent < -10)
+			return (uint16_t)sign;
+		mantissa |= 0x800000;
+		int shift = 14 - exponent;
+		uint32_t half = mantissa >> shift;
+		uint32_t rest = mantissa & ((1u << shift) - 1), halfway = 1u << (shift - 1);
+		if(rest > halfway || (rest == halfway && (half & 1)))
+			++half;
+		return (uint16_t)(sign | half);
+	}
+	// round to nearest even, a carry moves to the exponent
+	uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+	uint32_t rest = mantissa & 0x1fff;
+	if(rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+		++half;
+	return (uint16_t)half;
+}
+
+float TiledFramebuffer::half_to_float(uint16_t h)
+{
+	uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+	uint32_t exponent = (h >> 10) & 0x1f;
+	uint32_t mantissa = h & 0x3ff;
+	uint32_t x;
+	if(exponent == 0)
+	{
+		float f = std::ldexp((float)mantissa, -24);
+		return sign ? -f : f;
+	}
+	if(exponent == 31)
+		x = sign | 0x7f800000 | (mantissa << 13);
+	else
+		x = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	float f;
+	memcpy(&f, &x, sizeof(f));
+	return f;
+}
+
+// RGB9E5 as in EXT_texture_shared_exponent: exponent bias 15, 9 bit
+// mantissas without an implicit one
+uint32_t TiledFramebuffer::color_to_rgb9e5(const Color &c)
+{
+	const float max_value = 65408.0f;
+	// negative values and nan become 0
+	auto clamp = [max_value](float v) { return v > 0.0f ? std::min(v, max_value) : 0.0f; };
+	float r = clamp(c.r), g = clamp(c.g), b = clamp(c.b);
+	float max_c = std::max(r, std::max(g, b));
+
+	int e;
+	std::frexp(max_c, &e);
+	// frexp gives max_c = m * 2^e with m in [0.5, 1)
+	int exponent = std::max(-16, e - 1) + 1 + 15;
+	double scale = std::ldexp(1.0, exponent - 15 - 9);
+	if((int)std::floor(max_c / scale + 0.5) == 512)
+	{
+		scale *= 2;
+		++exponent;
+	}
+	uint32_t rm = (uint32_t)std::floor(r / scale + 0.5);
+	uint32_t gm = (uint32_t)std::floor(g / scale + 0.5);
+	uint32_t bm = (uint32_t)std::floor(b / scale + 0.5);
+	return rm | (gm << 9) | (bm << 18) | ((uint32_t)exponent << 27);
+}
+
+Color TiledFramebuffer::rgb9e5_to_color(uint32_t v)
+{
+	float scale = std::ldexp(1.0f, (int)(v >> 27) - 15 - 9);
+	return Color((v & 0x1ff) * scale, ((v >> 9) & 0x1ff) * scale, ((v >> 18) & 0x1ff) * scale);
+}
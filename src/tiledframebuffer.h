@@ -0,0 +1,141 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#ifndef TILEDFRAMEBUFFER_H
+#define TILEDFRAMEBUFFER_H
+
+#include "color.h"
+#include "mappedfile.h"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// side of a framebuffer tile, in pixels
+#define FRAMEBUFFER_TILE_SIZE 64
+// float tiles kept in memory when no size is given
+#define DEFAULT_FRAMEBUFFER_CACHE_MB 64
+
+// How the tiles are kept in the scratch file
+enum TileStorage
+{
+	HalfStorage,			// three 16 bit floats, 6 bytes a pixel
+	SharedExponentStorage	// RGB9E5, three 9 bit mantissas and one exponent, 4 bytes a pixel
+};
+
+struct FramebufferSettings
+{
+	FramebufferSettings() : tiled(false), storage(HalfStorage), cache_mb(DEFAULT_FRAMEBUFFER_CACHE_MB) {}
+
+	// half or rgb9e5
+	static bool parse_storage(const std::string &name, TileStorage &storage);
+
+	bool tiled;
+	TileStorage storage;
+	// working set, the tiles decoded to floats. It never goes below one
+	// row of tiles.
+	size_t cache_mb;
+};
+
+// Framebuffer for images too big to keep in memory as floats. The image is
+// split in square tiles stored in a memory mapped scratch file in a compact
+// format. The most recently used tiles are kept decoded in a fixed number
+// of cache slots; touching a tile that is not cached takes the slot of the
+// least recently used one, which is encoded back to the file first if it
+// was written. Pixels are read and written in place, consecutive accesses
+// to the same tile skip the cache lookup.
+class TiledFramebuffer
+{
+public:
+	TiledFramebuffer();
+
+	// the scratch file is created zero filled, and removed on close
+	bool create(size_t width, size_t height, const FramebufferSettings &settings, const std::string &scratch);
+	void close();
+
+	inline Color get(size_t w, size_t h) { return pixel(w, h, false); }
+	inline void set(size_t w, size_t h, const Color &c) { pixel(w, h, true) = c; }
+
+	// writes every modified cached tile to the scratch file
+	void flush();
+	// decodes one row of the image from the scratch file, after a flush.
+	// Reading the rows in order releases each band of tiles once passed.
+	void read_row(size_t h, Color *row);
+
+	void print(std::ostream &out) const;
+
+	inline size_t width() const { return width_px; }
+	inline size_t height() const { return height_px; }
+
+	static uint16_t float_to_half(float f);
+	static float half_to_float(uint16_t h);
+	static uint32_t color_to_rgb9e5(const Color &c);
+	static Color rgb9e5_to_color(uint32_t v);
+
+private:
+	struct Slot
+	{
+		size_t tile;
+		bool dirty;
+		int prev;	// towards the most recently used
+		int next;
+	};
+
+	inline Color &pixel(size_t w, size_t h, bool write)
+	{
+		size_t tile = (h / FRAMEBUFFER_TILE_SIZE) * tiles_x + w / FRAMEBUFFER_TILE_SIZE;
+		int slot = last;
+		if(slot < 0 || slots[slot].tile != tile)
+			slot = fetch(tile);
+		if(write)
+			slots[slot].dirty = true;
+		size_t x = w % FRAMEBUFFER_TILE_SIZE, y = h % FRAMEBUFFER_TILE_SIZE;
+		return cache[(size_t)slot * FRAMEBUFFER_TILE_SIZE * FRAMEBUFFER_TILE_SIZE + y * FRAMEBUFFER_TILE_SIZE + x];
+	}
+
+	int fetch(size_t tile);
+	void unlink_slot(int slot);
+	void push_front(int slot);
+	void store(int slot);
+	void load(int slot);
+	void encode(const Color &c, char *dst) const;
+	Color decode(const char *src) const;
+
+	size_t width_px;
+	size_t height_px;
+	size_t tiles_x;
+	size_t tiles_y;
+	TileStorage storage;
+	size_t pixel_bytes;
+	size_t tile_bytes;
+
+	std::vector<Color> cache;
+	std::vector<Slot> slots;
+	// cache slot of every tile, -1 when it is only in the file
+	std::vector<int> tile_slot;
+	// tiles written to the file at least once, the others are black
+	std::vector<bool> stored;
+	int head;
+	int tail;
+	int used;
+	int last;
+	MappedFile scratch;
+
+	size_t loads;
+	size_t stores;
+};
+
+#endif
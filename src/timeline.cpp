@@ -0,0 +1,126 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#include "timeline.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct TimelineEvent
+{
+	const char *name;
+	int64_t start;
+	int64_t end;
+};
+
+// events of one thread. Kept until exit, after the thread is gone
+struct ThreadTimeline
+{
+	std::vector<TimelineEvent> ring;
+	size_t count;
+	unsigned int id;
+};
+
+bool Timeline::active = false;
+static std::chrono::steady_clock::time_point timeline_epoch;
+static std::string timeline_file;
+static std::mutex timeline_mutex;
+static std::vector<std::unique_ptr<ThreadTimeline> > timeline_threads;
+static thread_local ThreadTimeline *thread_timeline = NULL;
+
+// the buffer is taken once per thread, before its first event
+static ThreadTimeline *current_thread_timeline()
+{
+	if(thread_timeline)
+		return thread_timeline;
+	std::unique_ptr<ThreadTimeline> t(new ThreadTimeline());
+	t->ring.resize(TIMELINE_RING_SIZE);
+	t->count = 0;
+	std::lock_guard<std::mutex> lock(timeline_mutex);
+	t->id = (unsigned int)timeline_threads.size();
+	thread_timeline = t.get();
+	timeline_threads.push_back(std::move(t));
+	return thread_timeline;
+}
+
+static void save_at_exit()
+{
+	Timeline::save();
+}
+
+void Timeline::enable(const char *file)
+{
+	if(active)
+		return;
+	timeline_file = file;
+	timeline_epoch = std::chrono::steady_clock::now();
+	// the calling thread is the main one
+	current_thread_timeline();
+	active = true;
+	atexit(save_at_exit);
+}
+
+int64_t Timeline::now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - timeline_epoch).count();
+}
+
+void Timeline::record(const char *name, int64_t start, int64_t end)
+{
+	ThreadTimeline *t = current_thread_timeline();
+	TimelineEvent &e = t->ring[t->count++ % TIMELINE_RING_SIZE];
+	e.name = name;
+	e.start = start;
+	e.end = end;
+}
+
+bool Timeline::save()
+{
+	if(!active)
+		return false;
+	FILE *out = fopen(timeline_file.c_str(), "w");
+	if(!out)
+	{
+		fprintf(stderr, "Failed to create timeline file: %s\n", timeline_file.c_str());
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(timeline_mutex);
+	// complete events ("X") in microseconds, one track per thread
+	fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+	bool first = true;
+	for(size_t i = 0; i < timeline_threads.size(); ++i)
+	{
+		const ThreadTimeline &t = *timeline_threads[i];
+		fprintf(out, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": \"%s %u\"}}",
+			first ? "" : ",\n", t.id, t.id ? "worker" : "main", t.id);
+		first = false;
+		size_t begin = t.count > TIMELINE_RING_SIZE ? t.count - TIMELINE_RING_SIZE : 0;
+		for(size_t k = begin; k < t.count; ++k)
+		{
+			const TimelineEvent &e = t.ring[k % TIMELINE_RING_SIZE];
+			fprintf(out, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}",
+				e.name, t.id, e.start * 1e-3, (e.end - e.start) * 1e-3);
+		}
+	}
+	fprintf(out, "\n]}\n");
+	fclose(out);
+	return true;
+}
@@ -0,0 +1,69 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <cstdint>
+
+// events a thread keeps, the oldest are overwritten when it is full
+#define TIMELINE_RING_SIZE (64 * 1024)
+
+// Timeline of the render stages (parsing, texture loading, sampler
+// generation, acceleration builds, rendering, saving). Every thread
+// records its scopes in its own ring buffer, they are written at exit as
+// a Chrome trace_event JSON file, to open in chrome://tracing or Perfetto.
+// Until enable is called a scope costs a flag test.
+class Timeline
+{
+public:
+	// record from now on, the file is written when the program exits
+	static void enable(const char *file);
+	static inline bool enabled() { return active; }
+
+	// nanoseconds since enable
+	static int64_t now();
+	// name must outlive the timeline, e.g. a string literal
+	static void record(const char *name, int64_t start, int64_t end);
+	static bool save();
+
+private:
+	static bool active;
+};
+
+// records the time between its construction and destruction
+class TimelineScope
+{
+public:
+	explicit TimelineScope(const char *event)
+		: name(event), start(Timeline::enabled() ? Timeline::now() : 0)
+	{}
+	~TimelineScope()
+	{
+		if(Timeline::enabled())
+			Timeline::record(name, start, Timeline::now());
+	}
+
+private:
+	const char *name;
+	int64_t start;
+};
+
+#define TIMELINE_CONCAT2(a, b) a##b
+#define TIMELINE_CONCAT(a, b) TIMELINE_CONCAT2(a, b)
+#define TIMELINE_SCOPE(name) TimelineScope TIMELINE_CONCAT(timeline_scope_, __LINE__)(name)
+
+#endif
@@ -0,0 +1,268 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#include "tokenizer.h"
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <sstream>
+#include <stdexcept>
+
+#if defined(__has_include)
+#if __has_include(<charconv>) && (__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+#include <charconv>
+#endif
+#endif
+
+// the header may exist without floating point support, the feature macro
+// is only set when it is complete
+#if defined(__cpp_lib_to_chars)
+#define TOKENIZER_FROM_CHARS
+#endif
+
+bool Token::operator==(const char *s) const
+{
+	return strncmp(ptr, s, length) == 0 && s[length] == '\0';
+}
+
+Tokenizer::Tokenizer(const char *begin, const char *end, const std::string &name)
+	: begin(begin), end(end), ptr(begin), line_start(begin), line(1), name(name)
+{}
+
+Tokenizer::Tokenizer(const Tokenizer &other, const Mark &mark)
+	: begin(other.begin), end(other.end), ptr(mark.ptr), line_start(mark.line_start), 
+	line(mark.line), name(other.name)
+{}
+
+static inline bool is_space(char c)
+{
+	return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+void Tokenizer::skip_space()
+{
+	while(ptr < end)
+	{
+		char c = *ptr;
+		if(c == '\n')
+		{
+			++line;
+			line_start = ptr + 1;
+		}
+		else if(!is_space(c))
+			return;
+		++ptr;
+	}
+}
+
+bool Tokenizer::at_end()
+{
+	skip_space();
+	return ptr == end;
+}
+
+bool Tokenizer::next_is(const char *keyword)
+{
+	Mark m = mark();
+	if(!at_end() && next(keyword) == keyword)
+		return true;
+	reset(m);
+	return false;
+}
+
+Token Tokenizer::next(const char *what)
+{
+	skip_space();
+
+	Token tok;
+	tok.ptr = ptr;
+	tok.line = line;
+	tok.column = ptr - line_start + 1;
+	while(ptr < end && !is_space(*ptr))
+		++ptr;
+	tok.length = ptr - tok.ptr;
+
+	if(tok.length == 0)
+		error(tok, std::string("unexpected end of file, expected ") + what);
+	return tok;
+}
+
+bool Tokenizer::next_in_line(Token &tok)
+{
+	while(ptr < end && *ptr != '\n' && is_space(*ptr))
+		++ptr;
+
+	tok.ptr = ptr;
+	tok.line = line;
+	tok.column = ptr - line_start + 1;
+	while(ptr < end && !is_space(*ptr))
+		++ptr;
+	tok.length = ptr - tok.ptr;
+	return tok.length > 0;
+}
+
+void Tokenizer::skip_line()
+{
+	while(ptr < end && *ptr != '\n')
+		++ptr;
+}
+
+void Tokenizer::skip(size_t count, const char *what)
+{
+	for(size_t i = 0; i < count; ++i)
+		next(what);
+}
+
+void Tokenizer::error(const Token &tok, const std::string &msg) const
+{
+	std::ostringstream out;
+	out << name << ":" << tok.line << ":" << tok.column << ": " << msg;
+	throw std::runtime_error(out.str());
+}
+
+// quote the offending token, long ones are cut
+static std::string quote(const Token &tok)
+{
+	const size_t max_length = 32;
+	if(tok.length > max_length)
+		return "'" + std::string(tok.ptr, max_length) + "...'";
+	return "'" + tok.str() + "'";
+}
+
+float Tokenizer::read_float(const char *what)
+{
+	return parse_float(next(what), what);
+}
+
+float Tokenizer::parse_float(const Token &tok, const char *what) const
+{
+	const char *first = tok.ptr;
+	const char *last = tok.ptr + tok.length;
+	// from_chars does not take the leading plus strtod accepts
+	if(*first == '+' && last - first > 1 && first[1] != '-')
+		++first;
+
+	float value = 0;
+	bool ok;
+#ifdef TOKENIZER_FROM_CHARS
+	std::from_chars_result r = std::from_chars(first, last, value);
+	ok = r.ec == std::errc() && r.ptr == last;
+#else
+	// the token is not null terminated
+	char buf[64];
+	size_t n = last - first;
+	ok = n < sizeof(buf);
+	if(ok)
+	{
+		memcpy(buf, first, n);
+		buf[n] = '\0';
+		char *stop;
+		errno = 0;
+		value = strtof(buf, &stop);
+		ok = stop == buf + n && errno != ERANGE;
+	}
+#endif
+	if(!ok)
+		error(tok, std::string("invalid ") + what + " " + quote(tok));
+	return value;
+}
+
+int Tokenizer::read_int(const char *what)
+{
+	return parse_int(next(what), what);
+}
+
+int Tokenizer::parse_int(const Token &tok, const char *what) const
+{
+	const char *first = tok.ptr;
+	const char *last = tok.ptr + tok.length;
+	if(*first == '+' && last - first > 1 && first[1] != '-')
+		++first;
+
+	int value = 0;
+	bool ok;
+#ifdef TOKENIZER_FROM_CHARS
+	std::from_chars_result r = std::from_chars(first, last, value);
+	ok = r.ec == std::errc() && r.ptr == last;
+#else
+	char buf[32];
+	size_t n = last - first;
+	ok = n < sizeof(buf);
+	if(ok)
+	{
+		memcpy(buf, first, n);
+		buf[n] = '\0';
+		char *stop;
+		errno = 0;
+		long v = strtol(buf, &stop, 10);
+		value = (int)v;
+		ok = stop == buf + n && errno != ERANGE && v == value;
+	}
+#endif
+	if(!ok)
+		error(tok, std::string("invalid ") + what + " " + quote(tok));
+	return value;
+}
+
+size_t Tokenizer::read_size(const char *what)
+{
+	return parse_size(next(what), what);
+}
+
+size_t Tokenizer::parse_size(const Token &tok, const char *what) const
+{
+	const char *first = tok.ptr;
+	const char *last = tok.ptr + tok.length;
+	if(*first == '+' && last - first > 1)
+		++first;
+
+	unsigned long long value = 0;
+	// strtoull would wrap negative numbers around
+	bool ok = *first != '-';
+#ifdef TOKENIZER_FROM_CHARS
+	std::from_chars_result r = std::from_chars(first, last, value);
+	ok = ok && r.ec == std::errc() && r.ptr == last;
+#else
+	char buf[32];
+	size_t n = last - first;
+	ok = ok && n < sizeof(buf);
+	if(ok)
+	{
+		memcpy(buf, first, n);
+		buf[n] = '\0';
+		char *stop;
+		errno = 0;
+		value = strtoull(buf, &stop, 10);
+		ok = stop == buf + n && errno != ERANGE;
+	}
+#endif
+	if(!ok || value != (size_t)value)
+		error(tok, std::string("invalid ") + what + " " + quote(tok));
+	return (size_t)value;
+}
+
+size_t Tokenizer::read_index(const char *what, size_t count)
+{
+	Token tok = next(what);
+	size_t value = parse_size(tok, what);
+	if(value >= count)
+	{
+		std::ostringstream msg;
+		msg << what << " " << value << " out of range (" << count << " defined)";
+		error(tok, msg.str());
+	}
+	return value;
+}
@@ -0,0 +1,93 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <cstddef>
+#include <string>
+
+// Whitespace separated word inside the scene text, it points into the
+// source buffer and is not null terminated.
+struct Token
+{
+	const char *ptr;
+	size_t length;
+	size_t line;
+	size_t column;
+
+	bool operator==(const char *s) const;
+	inline bool operator!=(const char *s) const { return !(*this == s); }
+	inline std::string str() const { return std::string(ptr, length); }
+};
+
+// Splits a scene file kept in memory into tokens and converts numbers in
+// place. Errors are thrown as std::runtime_error with file:line:column.
+class Tokenizer
+{
+public:
+	// position to resume tokenizing from
+	struct Mark
+	{
+		const char *ptr;
+		const char *line_start;
+		size_t line;
+	};
+
+	Tokenizer(const char *begin, const char *end, const std::string &name);
+	// same buffer, resumed at a mark taken by another tokenizer
+	Tokenizer(const Tokenizer &other, const Mark &mark);
+
+	// what names the expected value in error messages
+	Token next(const char *what);
+	void skip(size_t count, const char *what);
+	bool at_end();
+	// consumes the next token only if it is the given keyword
+	bool next_is(const char *keyword);
+	// for line based files: next token before the end of the current
+	// line, false if there is none
+	bool next_in_line(Token &tok);
+	// move past the end of the current line
+	void skip_line();
+
+	float read_float(const char *what);
+	int read_int(const char *what);
+	size_t read_size(const char *what);
+	// index into a list with count elements
+	size_t read_index(const char *what, size_t count);
+
+	inline Mark mark() const { Mark m = { ptr, line_start, line }; return m; }
+	inline void reset(const Mark &m) { ptr = m.ptr; line_start = m.line_start; line = m.line; }
+	inline size_t offset() const { return ptr - begin; }
+
+	float parse_float(const Token &tok, const char *what) const;
+	int parse_int(const Token &tok, const char *what) const;
+	size_t parse_size(const Token &tok, const char *what) const;
+
+	void error(const Token &tok, const std::string &msg) const;
+
+private:
+	const char *begin;
+	const char *end;
+	const char *ptr;
+	const char *line_start;
+	size_t line;
+	std::string name;
+
+	void skip_space();
+};
+
+#endif
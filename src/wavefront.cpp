@@ -0,0 +1,434 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#include "wavefront.h"
+#include "raytracer.h"
+#include "timeline.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#define SATURATE(a) std::max(a, 0.0f)
+
+static const char *stage_names[WAVEFRONT_STAGES] = { "generate", "extend", "shade", "shadow", "spawn" };
+
+void RayQueue::clear()
+{
+	origin_x.clear(); origin_y.clear(); origin_z.clear();
+	dir_x.clear(); dir_y.clear(); dir_z.clear();
+	time.clear();
+	sample.clear();
+	cone_width.clear(); cone_spread.clear();
+	node.clear();
+	excluded.clear();
+}
+
+void RayQueue::push(const Ray &ray, unsigned int n, const Object *excluded_obj)
+{
+	origin_x.push_back(ray.origin.x); origin_y.push_back(ray.origin.y); origin_z.push_back(ray.origin.z);
+	dir_x.push_back(ray.direction.x); dir_y.push_back(ray.direction.y); dir_z.push_back(ray.direction.z);
+	time.push_back(ray.time);
+	sample.push_back(ray.sample);
+	cone_width.push_back(ray.cone_width); cone_spread.push_back(ray.cone_spread);
+	node.push_back(n);
+	excluded.push_back(excluded_obj);
+}
+
+void ShadowQueue::clear()
+{
+	rays.clear();
+	light.clear();
+	diffuse.clear();
+	specular.clear();
+}
+
+void HitQueue::clear()
+{
+	ray.clear();
+	object.clear();
+	t.clear();
+	normal_x.clear(); normal_y.clear(); normal_z.clear();
+	object_inside.clear();
+	inside.clear();
+	contact_x.clear(); contact_y.clear(); contact_z.clear();
+	key.clear();
+	order.clear();
+}
+
+void HitQueue::push(unsigned int r, Object *obj, float dist, const Vector &normal, bool obj_inside)
+{
+	ray.push_back(r);
+	object.push_back(obj);
+	t.push_back(dist);
+	normal_x.push_back(normal.x); normal_y.push_back(normal.y); normal_z.push_back(normal.z);
+	object_inside.push_back(obj_inside);
+	inside.push_back(false);
+	contact_x.push_back(0); contact_y.push_back(0); contact_z.push_back(0);
+	key.push_back(0);
+	order.push_back(0);
+}
+
+WavefrontStats::WavefrontStats()
+{
+	memset(this, 0, sizeof(*this));
+}
+
+const char *WavefrontStats::stage_name(int stage)
+{
+	return stage_names[stage];
+}
+
+void WavefrontStats::print(std::ostream &out) const
+{
+	char line[120];
+	out << "wavefront stages:" << std::endl;
+	for(int i = 0; i < WAVEFRONT_STAGES; ++i)
+	{
+		snprintf(line, sizeof(line), "  %-9s %10zu %-6s %10.2f ms %9.2f M/s", stage_names[i], items[i], 
+			i == StageShade ? "hits" : "rays", seconds[i] * 1000, seconds[i] > 0 ? items[i] / seconds[i] * 1e-6 : 0.0);
+		out << line << std::endl;
+	}
+}
+
+void WavefrontStats::write_json(std::ostream &out, const char *indent) const
+{
+	out << "{";
+	for(int i = 0; i < WAVEFRONT_STAGES; ++i)
+		out << (i ? "," : "") << "\n" << indent << "  \"" << stage_names[i] << "\": { \"items\": " << items[i] 
+			<< ", \"seconds\": " << seconds[i] << " }";
+	out << "\n" << indent << "}";
+}
+
+// adds the time spent in a stage to the render totals, and to the timeline
+class StageTimer
+{
+public:
+	StageTimer(WavefrontStats &stats, WavefrontStage stage)
+		: stats(stats), stage(stage), scope(stage_names[stage]), start(std::chrono::steady_clock::now())
+	{}
+	~StageTimer()
+	{
+		stats.seconds[stage] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+private:
+	WavefrontStats &stats;
+	WavefrontStage stage;
+	TimelineScope scope;
+	std::chrono::steady_clock::time_point start;
+};
+
+void Raytracer::compute_wavefront(Scene &scene)
+{
+	Screen sc = scene.screen;
+	bool sampled = sc.samples > 1;
+	int num_samples = sampled ? sc.samples : 1;
+	float inv_samples = 1.0/num_samples;
+	if(sampled)
+		sampler = MultiJittered(num_samples);
+	float cone_spread = camera_cone_spread(scene);
+
+	float ev = scene.camera.exposure/scene.camera.shutter_time;
+	float shutter_weight = get_shutter_weight(scene);
+	// moving objects (only with one sample per pixel here) are traced once
+	// per shutter step, every step is a wave over the tile
+	bool moving = !scene.dynamic_objects.empty();
+
+	std::vector<size_t> tile_pixels;
+	std::vector<Color> tile_colors;
+	render_bands(scene, [&](FrameOutput &output, const PixelTraversal &pixels, size_t top, size_t t)
+	{
+		tile_pixels.clear();
+		pixels.for_each_pixel(t, [&](size_t w, size_t h)
+		{
+			tile_pixels.push_back(w);
+			tile_pixels.push_back(top + h);
+		});
+		size_t num_pixels = tile_pixels.size() / 2;
+		tile_colors.assign(num_pixels, Color());
+
+		float dt = 0;
+		do
+		{
+			float delta_time = moving ? dt/1000 : 0;
+			if(moving)
+				for(auto it = scene.dynamic_objects.begin(); it != scene.dynamic_objects.end(); ++it) 
+					(*it)->calculate_matrices(delta_time);
+
+			// camera rays, in the order the recursive renderer takes the
+			// samples, the node of every ray has the ray index
+			{
+				StageTimer timer(stages, StageGenerate);
+				extend_queue.clear();
+				path_nodes.clear();
+				for(size_t i = 0; i < num_pixels; ++i)
+				{
+					size_t w = tile_pixels[2 * i], h = tile_pixels[2 * i + 1];
+					for(int j = 0; j < num_samples; j++)
+					{
+						Ray ray(scene.camera.pos, Vector(), delta_time);
+						ray.cone_spread = cone_spread;
+						if(sampled)
+						{
+							Point sp = sampler.sample_unit_square();
+							Point dp = scene.camera.sampler->sample_unit_disk();
+							Point lp = dp * scene.camera.lens_radius;
+							ray.origin = scene.camera.pos + lp.x * scene.camera.x + lp.y * scene.camera.y;
+							ray.direction = get_ray_direction(scene, w, h, ray.origin, lp, sp);
+							ray.sample = (h * sc.width_px + w) * num_samples + j;
+						}
+						else
+						{
+							ray.direction = get_ray_direction(scene, w, h);
+							ray.sample = h * sc.width_px + w;
+						}
+						++rays.camera;
+						extend_queue.push(ray, (unsigned int)path_nodes.size(), NULL);
+						path_nodes.push_back(PathNode());
+					}
+				}
+				stages.items[StageGenerate] += extend_queue.size();
+			}
+
+			wave_trace(scene);
+
+			for(size_t i = 0; i < num_pixels; ++i)
+				for(int j = 0; j < num_samples; j++)
+				{
+					const Color &c = path_nodes[i * num_samples + j].color;
+					if(sampled)
+						tile_colors[i] += (c * shutter_weight) * inv_samples;
+					else if(moving)
+						tile_colors[i] += c * ev;
+					else
+						tile_colors[i] = c * shutter_weight;
+				}
+			dt += scene.camera.exposure;
+		} while(moving && dt < scene.camera.shutter_time);
+
+		for(size_t i = 0; i < num_pixels; ++i)
+			output.set_color(tile_pixels[2 * i], tile_pixels[2 * i + 1], tile_colors[i]);
+	});
+}
+
+void Raytracer::wave_trace(Scene &scene)
+{
+	size_t depth = max_depth;
+	while(extend_queue.size() > 0)
+	{
+		// one trace call for every ray of the wave
+		STAT(stats.traces[std::min<size_t>(max_depth - depth, STATS_MAX_DEPTH - 1)] += extend_queue.size());
+		wave_extend(scene);
+		wave_shade(scene);
+		wave_shadow(scene);
+		wave_spawn(depth);
+		std::swap(extend_queue, spawn_queue);
+		if(depth == 0)
+			break;
+		--depth;
+	}
+	wave_resolve(scene);
+}
+
+void Raytracer::wave_extend(Scene &scene)
+{
+	StageTimer timer(stages, StageExtend);
+	stages.items[StageExtend] += extend_queue.size();
+	hit_queue.clear();
+	for(size_t i = 0; i < extend_queue.size(); ++i)
+	{
+		Ray ray = extend_queue.ray(i);
+		float t = FLT_MAX;
+		Vector n;
+		bool obj_inside = false;
+		Object *obj = closest_hit(scene, ray, t, n, obj_inside, NULL, extend_queue.excluded[i], AnyMotion);
+		path_nodes[extend_queue.node[i]].hit = obj != NULL;
+		if(!obj)
+		{
+			STAT(++stats.trace_misses);
+			continue;
+		}
+		hit_queue.push((unsigned int)i, obj, t, n, obj_inside);
+	}
+}
+
+void Raytracer::wave_shade(Scene &scene)
+{
+	StageTimer timer(stages, StageShade);
+	stages.items[StageShade] += hit_queue.size();
+	shadow_queue.clear();
+
+	// hits of the same texture and material are shaded together
+	for(size_t i = 0; i < hit_queue.size(); ++i)
+	{
+		const Object *obj = hit_queue.object[i];
+		hit_queue.key[i] = ((unsigned long long)obj->texture->type << 32) | (unsigned int)obj->material.id;
+		hit_queue.order[i] = (unsigned int)i;
+	}
+	const std::vector<unsigned long long> &key = hit_queue.key;
+	std::sort(hit_queue.order.begin(), hit_queue.order.end(), [&](unsigned int a, unsigned int b) 
+	{
+		return key[a] < key[b] || (key[a] == key[b] && a < b);
+	});
+
+	for(size_t k = 0; k < hit_queue.size(); ++k)
+	{
+		unsigned int i = hit_queue.order[k];
+		Ray r = extend_queue.ray(hit_queue.ray[i]);
+		PathNode &node = path_nodes[extend_queue.node[hit_queue.ray[i]]];
+		Object *obj = hit_queue.object[i];
+
+		Intersection intersec;
+		bool inside = false;
+		Vector normal(hit_queue.normal_x[i], hit_queue.normal_y[i], hit_queue.normal_z[i]);
+		set_intersection(r, obj, hit_queue.t[i], normal, hit_queue.object_inside[i] != 0, intersec, &inside);
+		intersec.normal.normalize();
+		hit_queue.normal_x[i] = intersec.normal.x; hit_queue.normal_y[i] = intersec.normal.y; hit_queue.normal_z[i] = intersec.normal.z;
+		hit_queue.contact_x[i] = intersec.contact.x; hit_queue.contact_y[i] = intersec.contact.y; hit_queue.contact_z[i] = intersec.contact.z;
+		hit_queue.inside[i] = inside;
+
+		Material mat = intersec.object.material;
+		const Object *leaving = intersec.object.self_occluding() ? NULL : obj;
+		node.ambient = scene.ambient.color * mat.kA;
+		node.surface = surface_color(r, intersec);
+
+		// a shadow ray per light sample, with the light it brings if it
+		// gets through
+		Arena::Mark scratch_mark = scratch.mark();
+		size_t *near_lights = scratch.allocate_array<size_t>(scene.lights.size());
+		size_t num_near = scene.gather_lights(intersec.contact, near_lights);
+		for(size_t l = 0; l < num_near; ++l) 
+		{
+			const Light &lt = scene.lights[near_lights[l]];
+			float inv_samples = 1.0f/lt.num_samples;
+			const Point *light_points = lt.get_points(r.sample);
+			for(int j = 0; j < lt.num_samples; j++) 
+			{
+				const Point &light_pos = light_points[j];
+				Vector lightDir = (light_pos - intersec.contact).normalize();
+				float dist = Point::distance(light_pos, intersec.contact);
+				float att = 1.0f / (lt.att.a + dist * lt.att.b + (dist * dist) * lt.att.c);
+
+				float cosDiff = SATURATE(Vector::dot(lightDir, intersec.normal));
+				Vector e = r.direction * (-1); 
+				Vector halfway = lightDir + e;
+				halfway.normalize();
+				float cosSpec = SATURATE(Vector::dot(halfway, intersec.normal));
+				cosSpec = std::pow(cosSpec, mat.alpha);
+
+				Ray rl(ray_start(r, intersec, lightDir), lightDir, r.time);
+				shadow_queue.rays.push(rl, extend_queue.node[hit_queue.ray[i]], leaving);
+				shadow_queue.light.push_back((unsigned int)near_lights[l]);
+				shadow_queue.diffuse.push_back((lt.color * cosDiff * mat.kD * att) * inv_samples);
+				shadow_queue.specular.push_back((lt.color * cosSpec * mat.kS * att) * inv_samples);
+			}
+		}
+		scratch.rewind(scratch_mark);
+	}
+}
+
+void Raytracer::wave_shadow(Scene &scene)
+{
+	StageTimer timer(stages, StageShadow);
+	stages.items[StageShadow] += shadow_queue.size();
+	for(size_t i = 0; i < shadow_queue.size(); ++i)
+	{
+		// the samples of a node are in order, so its light adds up as in
+		// the recursive renderer
+		Ray rl = shadow_queue.rays.ray(i);
+		if(occluded(scene, rl, scene.lights[shadow_queue.light[i]], shadow_queue.rays.excluded[i]))
+			continue;
+		PathNode &node = path_nodes[shadow_queue.rays.node[i]];
+		node.diffuse += shadow_queue.diffuse[i];
+		node.specular += shadow_queue.specular[i];
+	}
+}
+
+void Raytracer::wave_spawn(size_t depth)
+{
+	StageTimer timer(stages, StageSpawn);
+	spawn_queue.clear();
+	if(depth == 0)
+		return;
+	for(size_t i = 0; i < hit_queue.size(); ++i)
+	{
+		Object *obj = hit_queue.object[i];
+		const Material &mat = obj->material;
+		if(mat.kR <= 0 && mat.kT <= 0)
+			continue;
+
+		Ray r = extend_queue.ray(hit_queue.ray[i]);
+		unsigned int parent = extend_queue.node[hit_queue.ray[i]];
+		Intersection intersec;
+		intersec.contact = Point(hit_queue.contact_x[i], hit_queue.contact_y[i], hit_queue.contact_z[i]);
+		intersec.normal = Vector(hit_queue.normal_x[i], hit_queue.normal_y[i], hit_queue.normal_z[i]);
+		intersec.object = *obj;
+		const Object *leaving = obj->self_occluding() ? NULL : obj;
+
+		if(mat.kR > 0)
+		{
+			Vector reflect_dir = get_reflection_direction(r.direction, intersec.normal);
+			Ray reflec_ray(ray_start(r, intersec, reflect_dir), reflect_dir, r.time, r.sample);
+			reflec_ray.continue_cone(r, intersec.contact);
+			++rays.reflection;
+			spawn_queue.push(reflec_ray, (unsigned int)path_nodes.size(), leaving);
+			path_nodes.push_back(PathNode(parent, true, mat.kR));
+		}
+
+		if(mat.kT > 0)
+		{
+			float refr_rate = 1.0f / mat.ior;
+			if(hit_queue.inside[i])
+				refr_rate = mat.ior;
+
+			Vector trans_dir;
+			if(get_transmission_direction(refr_rate, r.direction, intersec.normal, trans_dir)) 
+			{
+				Ray refrac_ray(ray_start(r, intersec, trans_dir), trans_dir, r.time, r.sample);
+				refrac_ray.continue_cone(r, intersec.contact);
+				++rays.refraction;
+				spawn_queue.push(refrac_ray, (unsigned int)path_nodes.size(), leaving);
+				path_nodes.push_back(PathNode(parent, false, mat.kT));
+			}
+		}
+	}
+	stages.items[StageSpawn] += spawn_queue.size();
+}
+
+void Raytracer::wave_resolve(Scene &scene)
+{
+	// children come after their parents, so from the end every node
+	// finds the colors of its rays ready
+	for(size_t i = path_nodes.size(); i-- > 0; )
+	{
+		PathNode &node = path_nodes[i];
+		if(node.hit)
+		{
+			node.color = (node.surface * (node.ambient + node.diffuse) + node.specular + node.reflect + node.refract);
+			node.color.clamp();
+		}
+		else
+			node.color = scene.ambient.color;
+
+		if(node.parent == NO_PARENT)
+			continue;
+		PathNode &parent = path_nodes[node.parent];
+		if(node.reflected)
+			parent.reflect = node.color * node.weight;
+		else
+			parent.refract = node.color * node.weight;
+	}
+}
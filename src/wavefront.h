@@ -0,0 +1,137 @@
+/*
+* Copyright (C) 2015 Sergio Nunes da Silva Junior 
+*
+* This program is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the Free
+* Software Foundation; either version 2 of the License.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+* more details.
+*
+* author: Sergio Nunes da Silva Junior
+* contact: sergio.nunes@dcc.ufmg.com.br
+* Universidade Federal de Minas Gerais (UFMG) 
+*/
+#ifndef WAVEFRONT_H
+#define WAVEFRONT_H
+
+#include "ray.h"
+#include "color.h"
+#include <climits>
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+class Object;
+
+// Queues of the wavefront renderer (Raytracer::compute_wavefront). The
+// camera rays of a tile go through the stages together, one depth at a
+// time: they are extended to their closest hit, the hits are shaded
+// sorted by texture and material (queuing a shadow ray per light sample),
+// the shadow rays look for any hit and the reflected and refracted rays
+// of the next depth are spawned. Once the deepest rays are done the colors
+// are summed up from the leaves, as the recursive trace does, so both
+// renderers make the same image.
+
+enum WavefrontStage
+{
+	StageGenerate,
+	StageExtend,
+	StageShade,
+	StageShadow,
+	StageSpawn,
+	WAVEFRONT_STAGES
+};
+
+// rays waiting for a stage, as a structure of arrays
+struct RayQueue
+{
+	std::vector<float> origin_x, origin_y, origin_z;
+	std::vector<float> dir_x, dir_y, dir_z;
+	std::vector<float> time;
+	std::vector<size_t> sample;
+	std::vector<float> cone_width, cone_spread;
+	// path node the ray extends, or lights for shadow rays
+	std::vector<unsigned int> node;
+	// object the ray leaves, it is not tested
+	std::vector<const Object*> excluded;
+
+	inline size_t size() const { return node.size(); }
+	void clear();
+	void push(const Ray &ray, unsigned int node, const Object *excluded);
+	inline Ray ray(size_t i) const
+	{
+		Ray r(Point(origin_x[i], origin_y[i], origin_z[i]), Vector(dir_x[i], dir_y[i], dir_z[i]), time[i], sample[i]);
+		r.cone_width = cone_width[i];
+		r.cone_spread = cone_spread[i];
+		return r;
+	}
+};
+
+// shadow rays with the light they reach and what the light adds to their
+// node when nothing blocks it
+struct ShadowQueue
+{
+	RayQueue rays;
+	std::vector<unsigned int> light;
+	std::vector<Color> diffuse, specular;
+
+	inline size_t size() const { return rays.size(); }
+	void clear();
+};
+
+// closest hits of the extended rays. The shading stage fills the contact
+// and the facing normal, the spawn stage reads them.
+struct HitQueue
+{
+	std::vector<unsigned int> ray;		// in the extended queue
+	std::vector<Object*> object;
+	std::vector<float> t;
+	std::vector<float> normal_x, normal_y, normal_z;
+	std::vector<unsigned char> object_inside;	// as found by the hit test
+	std::vector<unsigned char> inside;		// ray inside the object
+	std::vector<float> contact_x, contact_y, contact_z;
+	// shading order, by texture type then material
+	std::vector<unsigned long long> key;
+	std::vector<unsigned int> order;
+
+	inline size_t size() const { return ray.size(); }
+	void clear();
+	void push(unsigned int ray, Object *object, float t, const Vector &normal, bool object_inside);
+};
+
+#define NO_PARENT UINT_MAX
+
+// One trace call of the recursive renderer: the light its hit gathers and
+// the colors of its reflected and refracted rays, weighted by the
+// material. Children always come after their parent.
+struct PathNode
+{
+	unsigned int parent;	// NO_PARENT for camera rays
+	bool reflected;			// reflected or refracted ray of the parent
+	float weight;			// kR or kT of the parent material
+	bool hit;
+	Color surface, ambient, diffuse, specular, reflect, refract;
+	Color color;			// once resolved
+
+	PathNode(unsigned int parent = NO_PARENT, bool reflected = false, float weight = 1)
+		: parent(parent), reflected(reflected), weight(weight), hit(false)
+	{}
+};
+
+// time and items (rays, hits) of every stage over a render
+struct WavefrontStats
+{
+	WavefrontStats();
+
+	double seconds[WAVEFRONT_STAGES];
+	size_t items[WAVEFRONT_STAGES];
+
+	static const char *stage_name(int stage);
+	void print(std::ostream &out) const;
+	void write_json(std::ostream &out, const char *indent) const;
+};
+
+#endif